@@ -0,0 +1,26 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Example printing how much memory each ZJS module has allocated, every few
+// seconds; a module whose live bytes keep growing is leaking
+
+// Hardware Requirements:
+//   - None
+
+print("Starting MemoryUsage example...");
+
+var timers = [];
+
+setInterval(function() {
+    // allocate a little in the timers and buffer modules each time
+    timers.push(setTimeout(function() {}, 100000));
+    var buf = new Buffer(16);
+
+    var usage = process.memoryUsage();
+    print("Total: " + usage.live + " bytes live, " + usage.peak + " peak, " +
+          usage.failures + " failures");
+    for (var name in usage.modules) {
+        var module = usage.modules[name];
+        print("  " + name + ": " + module.live + " bytes live in " +
+              module.allocs + " allocations");
+    }
+}, 2000);
@@ -0,0 +1,70 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Benchmark for the native bulk Buffer methods, compared to doing the same
+// work a byte at a time from JavaScript
+print("Buffer bulk operations benchmark...");
+
+var SIZE = 64;
+var RUNS = 200;
+
+var src = new Buffer(SIZE);
+var dst = new Buffer(SIZE);
+for (var i = 0; i < SIZE; i++)
+    src.writeUInt8(i, i);
+
+function time(name, fn) {
+    var start = Date.now();
+    for (var run = 0; run < RUNS; run++)
+        fn();
+    print(name + ": " + (Date.now() - start) + " ms for " + RUNS + " runs");
+}
+
+time("copy, JS loop", function() {
+    for (var i = 0; i < SIZE; i++)
+        dst.writeUInt8(src.readUInt8(i), i);
+});
+time("copy, native", function() {
+    src.copy(dst);
+});
+
+time("fill, JS loop", function() {
+    for (var i = 0; i < SIZE; i++)
+        dst.writeUInt8(0xaa, i);
+});
+time("fill, native", function() {
+    dst.fill(0xaa);
+});
+
+src.copy(dst);
+time("equals, JS loop", function() {
+    for (var i = 0; i < SIZE; i++) {
+        if (dst.readUInt8(i) !== src.readUInt8(i))
+            break;
+    }
+});
+time("equals, native", function() {
+    dst.equals(src);
+});
+
+time("indexOf, JS loop", function() {
+    for (var i = 0; i < SIZE; i++) {
+        if (src.readUInt8(i) === SIZE - 1)
+            break;
+    }
+});
+time("indexOf, native", function() {
+    src.indexOf(SIZE - 1);
+});
+
+var halves = [src.slice(0, SIZE / 2), src.slice(SIZE / 2)];
+time("concat, JS loop", function() {
+    var joined = new Buffer(SIZE);
+    var pos = 0;
+    for (var i = 0; i < halves.length; i++) {
+        for (var j = 0; j < halves[i].length; j++)
+            joined.writeUInt8(halves[i].readUInt8(j), pos++);
+    }
+});
+time("concat, native", function() {
+    Buffer.concat(halves);
+});
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+#
+# This script compiles a JS file to a JerryScript snapshot on the host, and
+# writes the bytecode out as a C array:
+#
+# const uint8_t snapshot_bytecode[] = { ........ }
+#
+# The snapshot is made by a host build of the JerryScript in deps, so it
+# matches the engine linked into the binary. The array is const so it is
+# linked into flash, and the engine runs the bytecode in place from there.
+#
+
+INPUT=$1
+OUTPUT=$2
+
+JERRY_BASE=${JERRY_BASE:-$ZJS_BASE/deps/jerryscript}
+SNAPSHOT_BUILD=$JERRY_BASE/build/snapshot
+JERRY=$SNAPSHOT_BUILD/bin/jerry
+
+if [ ! -x $JERRY ]; then
+    echo Building JerryScript for the host to save snapshots...
+    # memorystats uses the heap stats to measure parsing
+    (cd $JERRY_BASE; python ./tools/build.py --snapshot-save=on \
+        --mem-stats=on --builddir=$SNAPSHOT_BUILD) > /dev/null
+    if [ ! -x $JERRY ]; then
+        echo Error: Could not build $JERRY
+        exit 1
+    fi
+fi
+
+# minify first, like convert.sh, so the snapshot's literals are smaller too
+if which uglifyjs &> /dev/null; then
+    if uglifyjs --version &> /dev/null; then
+        uglifyjs $INPUT -nc -mt > /tmp/gen.tmp
+    else
+        uglifyjs -nc -mt $INPUT > /tmp/gen.tmp
+    fi
+    ERR=$?
+    if (($ERR > 0)); then
+        echo Error: Minification failed!
+        exit $ERR
+    fi
+else
+    cat $INPUT > /tmp/gen.tmp
+fi
+
+rm -f /tmp/gen.snapshot
+$JERRY --save-snapshot-for-global /tmp/gen.snapshot /tmp/gen.tmp
+if [ ! -s /tmp/gen.snapshot ]; then
+    echo Error: Could not save a snapshot of $INPUT
+    rm -f /tmp/gen.tmp
+    exit 1
+fi
+
+printf "/* This file was auto-generated */\n\n" > $OUTPUT
+printf "#include \"zjs_common.h\"\n\n" >> $OUTPUT
+printf "#include <stddef.h>\n#include <stdint.h>\n\n" >> $OUTPUT
+# bytecode run in place must have the engine's heap alignment
+printf "const uint8_t snapshot_bytecode[] __attribute__((aligned(8))) = {\n" \
+    >> $OUTPUT
+od -An -v -tx1 /tmp/gen.snapshot | \
+    sed -e 's/ *\([0-9a-f][0-9a-f]\)/0x\1, /g' -e 's/, $/,/' -e 's/^/    /' \
+    >> $OUTPUT
+printf "};\n\n" >> $OUTPUT
+printf "const size_t snapshot_len = sizeof(snapshot_bytecode);\n" >> $OUTPUT
+
+echo Snapshot of $INPUT is $(stat -c%s /tmp/gen.snapshot 2>/dev/null || \
+    stat -f%z /tmp/gen.snapshot) bytes
+
+rm -f /tmp/gen.tmp /tmp/gen.snapshot
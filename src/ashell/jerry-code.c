@@ -31,8 +31,11 @@
 
 #include "acm-uart.h"
 #include "file-wrapper.h"
+#include "../zjs_names.h"
 
 static jerry_value_t parsed_code = 0;
+/* a snapshot has run since the engine was last reset */
+static bool snapshot_loaded = false;
 
 #define MAX_BUFFER_SIZE 4096
 
@@ -53,42 +56,87 @@ void javascript_eval_code(const char *source_buffer)
 
 void javascript_stop()
 {
-    if (parsed_code == 0)
+    if (parsed_code == 0 && !snapshot_loaded)
         return;
 
     /* Parsed source code must be freed */
-    jerry_release_value(parsed_code);
+    if (parsed_code != 0)
+        jerry_release_value(parsed_code);
     parsed_code = 0;
+    snapshot_loaded = false;
 
     /* Cleanup engine */
+    zjs_names_cleanup();
     jerry_cleanup();
 
     /* Initialize engine */
     jerry_init(JERRY_INIT_EMPTY);
+    zjs_names_init();
 }
 
-void javascript_run_code(const char *file_name)
+static char *read_code(const char *file_name, off_t *len)
 {
-    javascript_stop();
-
     ZFILE *fp = csopen(file_name, "r");
     if (fp == NULL)
-        return;
+        return NULL;
 
     fs_seek(fp, 0, SEEK_END);
-    off_t len = fs_tell(fp);
-    if (len == 0) {
+    *len = fs_tell(fp);
+    if (*len == 0) {
+        fs_close(fp);
         printf("Empty file\n");
-        return;
+        return NULL;
     }
 
-    char *buf = (char *)malloc(len);
+    /* malloc'd memory is word aligned, as snapshots need to be */
+    char *buf = (char *)malloc(*len);
+    if (buf == NULL) {
+        fs_close(fp);
+        printf("Not enough memory to load %s\n", file_name);
+        return NULL;
+    }
 
     fs_seek(fp, 0, SEEK_SET);
-    ssize_t brw = fs_read(fp, buf, len);
+    ssize_t brw = fs_read(fp, buf, *len);
+    fs_close(fp);
     if (brw < 0) {
-        fs_close(fp);
+        free(buf);
         printf(" Failed loading code from disk %s ", file_name);
+        return NULL;
+    }
+    return buf;
+}
+
+static void run_snapshot(const char *buf, off_t len)
+{
+    /* The bytecode is copied into the engine, so buf can be freed after */
+    jerry_value_t ret_value = jerry_exec_snapshot(buf, len, true);
+    snapshot_loaded = true;
+
+    if (jerry_value_has_error_flag(ret_value)) {
+        printf("JerryScript: could not run snapshot\n");
+    }
+
+    /* Returned value must be freed */
+    jerry_release_value(ret_value);
+}
+
+void javascript_run_code(const char *file_name)
+{
+    javascript_stop();
+
+    off_t len;
+    char *buf = read_code(file_name, &len);
+    if (buf == NULL)
+        return;
+
+    /*
+     * JavaScript source never contains a NUL, while a snapshot starts with
+     * its version as a little endian word, so run those as bytecode
+     */
+    if (len >= 4 && memchr(buf, 0, 4)) {
+        run_snapshot(buf, len);
+        free(buf);
         return;
     }
 
@@ -111,5 +159,13 @@ void javascript_run_code(const char *file_name)
 
 void javascript_run_snapshot(const char *file_name)
 {
+    javascript_stop();
 
+    off_t len;
+    char *buf = read_code(file_name, &len);
+    if (buf == NULL)
+        return;
+
+    run_snapshot(buf, len);
+    free(buf);
 }
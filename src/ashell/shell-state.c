@@ -36,6 +36,7 @@
 #include "file-wrapper.h"
 #include "ihex-handler.h"
 #include "jerry-code.h"
+#include "../zjs_mem.h"
 
 #ifdef CONFIG_REBOOT
 //TODO Waiting for patch https://gerrit.zephyrproject.org/r/#/c/3161/
@@ -521,6 +522,39 @@ int32_t ashell_stop_javascript(char *buf)
     return RET_OK;
 }
 
+static void ashell_print_mem_stats(const char *name,
+                                   const zjs_mem_stats_t *stats)
+{
+    acm_printf("%-20s %8lu %8lu %8lu %8lu\r\n", name, stats->live,
+               stats->peak, stats->allocs, stats->failures);
+}
+
+int32_t ashell_memory_usage(char *buf)
+{
+    acm_printf("%-20s %8s %8s %8s %8s\r\n", "module", "live", "peak",
+               "allocs", "failures");
+    const zjs_mem_module_t *module;
+    for (int i = 0; (module = zjs_mem_get_module(i)); i++) {
+        ashell_print_mem_stats(module->name, &module->stats);
+    }
+    ashell_print_mem_stats("total", zjs_mem_total());
+
+#ifdef ZJS_MEM_SITES
+    if (buf != NULL && !strncmp(buf, "sites", 5)) {
+        acm_println("");
+        const zjs_mem_site_t *site;
+        for (int i = 0; (site = zjs_mem_get_site(i)); i++) {
+            char name[24];
+            const char *file = strrchr(site->file, '/');
+            snprintf(name, sizeof(name), "%s:%lu",
+                     file ? file + 1 : site->file, (unsigned long)site->line);
+            ashell_print_mem_stats(name, &site->stats);
+        }
+    }
+#endif
+    return RET_OK;
+}
+
 int32_t ashell_check_control(const char *buf, uint32_t len)
 {
     while (len > 0) {
@@ -561,6 +595,7 @@ static const struct shell_cmd commands[] =
 
     ASHELL_COMMAND("set",   "Sets the input mode for 'load' accept data\r\n\ttransfer raw\r\n\ttransfer ihex\t",ashell_set_state),
     ASHELL_COMMAND("get",   "Get states on the shell"                        ,ashell_get_state),
+    ASHELL_COMMAND("mem",   "[sites] Memory use by module, or by call site"  ,ashell_memory_usage),
     ASHELL_COMMAND("reboot","Reboots the device"                             ,ashell_reboot)
 };
 
@@ -21,13 +21,22 @@
 #include "zjs_callbacks.h"
 #include "zjs_common.h"
 #include "zjs_event.h"
+#include "zjs_mem.h"
 #include "zjs_modules.h"
+#include "zjs_names.h"
 #include "zjs_timers.h"
 #include "zjs_util.h"
 
 #include "zjs_ble.h"
 
+#ifdef ZJS_SNAPSHOT_BUILD
+// bytecode of the JS application, saved by scripts/snapshot.sh at build time;
+//   it is const so it stays in flash on XIP boards, and runs from there
+extern const uint8_t snapshot_bytecode[];
+extern const size_t snapshot_len;
+#else
 extern const char *script_gen;
+#endif
 
 // native eval handler
 static jerry_value_t native_eval_handler(const jerry_value_t function_obj,
@@ -61,7 +70,9 @@ int main(int argc, char *argv[])
 #endif
 
     jerry_init(JERRY_INIT_EMPTY);
+    zjs_names_init();
 
+    zjs_loop_init();
     zjs_timers_init();
 #ifndef ZJS_LINUX_BUILD
     zjs_queue_init();
@@ -73,20 +84,26 @@ int main(int argc, char *argv[])
 
     // initialize modules
     zjs_modules_init();
+    zjs_mem_init();
 
 #ifdef ZJS_LINUX_BUILD
     if (argc > 1) {
         zjs_read_script(argv[1], &script, &len);
+        if (!script) {
+            goto error;
+        }
     } else
     // slightly tricky: reuse next section as else clause
 #endif
     {
+#ifndef ZJS_SNAPSHOT_BUILD
         script = script_gen;
         len = strnlen(script_gen, MAX_SCRIPT_SIZE);
         if (len == MAX_SCRIPT_SIZE) {
             PRINT("Error: Script size too large! Increase MAX_SCRIPT_SIZE.\n");
             goto error;
         }
+#endif
     }
 
     jerry_value_t global_obj = jerry_get_global_object();
@@ -95,26 +112,37 @@ int main(int argc, char *argv[])
     // For now, just inject our eval() function in the global space
     zjs_obj_add_function(global_obj, native_eval_handler, "eval");
 
-    code_eval = jerry_parse((jerry_char_t *)script, len, false);
-    if (jerry_value_has_error_flag(code_eval)) {
-        PRINT("JerryScript: cannot parse javascript\n");
-        goto error;
-    }
+#ifdef ZJS_SNAPSHOT_BUILD
+    if (!script) {
+        // the application was compiled on the host, so skip the parser and
+        //   the heap it needs; the bytecode isn't copied, only the literals
+        //   and function headers go in the heap
+        result = jerry_exec_snapshot(snapshot_bytecode, snapshot_len, false);
+    } else
+#endif
+    {
+        code_eval = jerry_parse((jerry_char_t *)script, len, false);
+        if (jerry_value_has_error_flag(code_eval)) {
+            PRINT("JerryScript: cannot parse javascript\n");
+            goto error;
+        }
 
 #ifdef ZJS_LINUX_BUILD
-    if (argc > 1) {
-        zjs_free_script(script);
-    }
+        if (argc > 1) {
+            zjs_free_script(script);
+        }
 #endif
 
-    result = jerry_run(code_eval);
+        result = jerry_run(code_eval);
+        jerry_release_value(code_eval);
+    }
     if (jerry_value_has_error_flag(result)) {
         PRINT("JerryScript: cannot run javascript\n");
         goto error;
     }
+    zjs_run_microtasks();
 
     jerry_release_value(global_obj);
-    jerry_release_value(code_eval);
     jerry_release_value(result);
 
 #ifndef ZJS_LINUX_BUILD
@@ -126,14 +154,15 @@ int main(int argc, char *argv[])
 #endif // ZJS_LINUX_BUILD
 
     while (1) {
-        zjs_timers_process_events();
+        int32_t wait = zjs_timers_process_events();
 #ifndef ZJS_LINUX_BUILD
         zjs_run_pending_callbacks();
+        zjs_run_microtasks();
 #endif
         zjs_service_callbacks();
-        // not sure if this is okay, but it seems better to sleep than
-        //   busy wait
-        zjs_sleep(1);
+        // sleep until the next timer is due, unless a signal comes in first;
+        //   anything signaled while servicing makes this return right away
+        zjs_loop_block(wait);
     }
 
 error:
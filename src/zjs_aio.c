@@ -9,10 +9,14 @@
 #include "zjs_aio.h"
 #include "zjs_callbacks.h"
 #include "zjs_ipm.h"
+#include "zjs_objpool.h"
 #include "zjs_util.h"
 
 #define ZJS_AIO_TIMEOUT_TICKS                      500
 
+// IPM messages kept for reuse, more than this are heap allocated
+#define AIO_MSG_POOL_SIZE                          2
+
 static struct nano_sem aio_sem;
 
 #define MAX_TYPE_LEN 20
@@ -39,9 +43,11 @@ static void zjs_aio_free_handle(aio_handle_t *handle)
     zjs_free(handle);
 }
 
+ZJS_OBJPOOL(aio_msg_pool, zjs_ipm_message_t, AIO_MSG_POOL_SIZE)
+
 static zjs_ipm_message_t* zjs_aio_alloc_msg()
 {
-    zjs_ipm_message_t *msg = zjs_malloc(sizeof(zjs_ipm_message_t));
+    zjs_ipm_message_t *msg = aio_msg_pool_alloc();
     if (!msg) {
         PRINT("zjs_aio_alloc_msg: cannot allocate message\n");
         return NULL;
@@ -61,7 +67,7 @@ static void zjs_aio_free_msg(zjs_ipm_message_t* msg)
         return;
 
     if (msg->flags & MSG_SAFE_TO_FREE_FLAG) {
-        zjs_free(msg);
+        aio_msg_pool_free(msg);
     } else {
         PRINT("zjs_aio_free_msg: error! do not free message\n");
     }
@@ -131,6 +137,10 @@ static jerry_value_t *zjs_aio_pre_callback(void *h, uint32_t *argc)
 {
     // effects: sets up value argument for the callback
     aio_handle_t *handle = (aio_handle_t *)h;
+    uint32_t value;
+    if (zjs_get_isr_event(&value, NULL)) {
+        handle->value = (double)value;
+    }
     *argc = 1;
     handle->jvalue = jerry_create_number(handle->value);
     return &handle->jvalue;
@@ -171,8 +181,8 @@ static void ipm_msg_receive_callback(void *context, uint32_t id,
         switch(msg->type) {
         case TYPE_AIO_PIN_READ:
         case TYPE_AIO_PIN_EVENT_VALUE_CHANGE:
-            handle->value = (double)pin_value;
-            zjs_signal_callback(handle->callback_id);
+            zjs_signal_callback_isr(handle->callback_id, pin_value,
+                                    ZJS_PRIO_NORMAL);
             break;
         case TYPE_AIO_PIN_SUBSCRIBE:
             DBG_PRINT("ipm_msg_receive_callback: subscribed to events on pin %lu\n", pin);
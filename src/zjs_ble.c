@@ -297,19 +297,12 @@ static void zjs_ble_write_attr_call_function(struct zjs_callback *cb)
     jerry_value_t func_obj;
 
     if (mycb->buffer && mycb->buffer_size > 0) {
-        jerry_value_t buf_obj = zjs_buffer_create(mycb->buffer_size);
-
-        if (buf_obj) {
-           zjs_buffer_t *buf = zjs_buffer_find(buf_obj);
-
-           if (buf &&
-               buf->buffer &&
-               buf->bufsize == mycb->buffer_size) {
-               memcpy(buf->buffer, mycb->buffer, mycb->buffer_size);
-               args[0]= buf_obj;
-           } else {
-               args[0] = jerry_create_null();
-           }
+        zjs_buffer_t *buf;
+        jerry_value_t buf_obj = zjs_buffer_create(mycb->buffer_size, &buf);
+
+        if (buf) {
+            memcpy(buf->buffer, mycb->buffer, mycb->buffer_size);
+            args[0] = buf_obj;
         } else {
             args[0] = jerry_create_null();
         }
@@ -438,6 +431,7 @@ static void zjs_ble_connected_c_callback(void *handle)
     // FIXME: get real bluetooth address
     jerry_value_t arg = jerry_create_string((jerry_char_t *)"AB:CD:DF:AB:CD:EF");
     zjs_trigger_event(ble_conn->ble_obj, "accept", &arg, 1, NULL, NULL);
+    jerry_release_value(arg);
     DBG_PRINT("BLE event: accept\n");
 }
 
@@ -457,6 +451,7 @@ static void zjs_ble_disconnected_c_callback(void *handle)
     // FIXME: get real bluetooth address
     jerry_value_t arg = jerry_create_string((jerry_char_t *)"AB:CD:DF:AB:CD:EF");
     zjs_trigger_event(ble_conn->ble_obj, "disconnect", &arg, 1, NULL, NULL);
+    jerry_release_value(arg);
     DBG_PRINT("BLE event: disconnect\n");
 }
 
@@ -492,6 +487,7 @@ static void zjs_ble_ready_c_callback(void *handle)
 {
     jerry_value_t arg = jerry_create_string((jerry_char_t *)"poweredOn");
     zjs_trigger_event(ble_conn->ble_obj, "stateChange", &arg, 1, NULL, NULL);
+    jerry_release_value(arg);
     DBG_PRINT("BLE event: stateChange - poweredOn");
 }
 
@@ -696,6 +692,7 @@ static jerry_value_t zjs_ble_start_advertising(const jerry_value_t function_obj,
                                 jerry_create_null();
 
     zjs_trigger_event(ble_conn->ble_obj, "advertisingStart", &error, 1, NULL, NULL);
+    jerry_release_value(error);
     DBG_PRINT("BLE event: adveristingStart\n");
 
     zjs_free(url_frame);
@@ -1097,6 +1094,7 @@ static jerry_value_t zjs_ble_update_rssi(const jerry_value_t function_obj,
     // Todo: get actual RSSI value from Zephyr Bluetooth driver
     jerry_value_t arg = jerry_create_number(-50);
     zjs_trigger_event(ble_conn->ble_obj, "rssiUpdate", &arg, 1, NULL, NULL);
+    jerry_release_value(arg);
     return ZJS_UNDEFINED;
 }
 
@@ -3,8 +3,12 @@
 #ifndef ZJS_LINUX_BUILD
 // Zephyr includes
 #include <zephyr.h>
+#else
+#include <stdlib.h>
 #endif
 
+#include <math.h>
+#include <stdint.h>
 #include <string.h>
 
 // JerryScript includes
@@ -13,197 +17,502 @@
 // ZJS includes
 #include "zjs_util.h"
 #include "zjs_buffer.h"
+#include "zjs_names.h"
+
+// scratch space for encoding and decoding strings comes from the heap, not
+//   zjs_malloc, because the strings of large buffers outgrow the biggest pool
+//   block
+#ifdef ZJS_LINUX_BUILD
+#define scratch_malloc(sz) malloc(sz)
+#define scratch_free(ptr) free(ptr)
+#else
+#define scratch_malloc(sz) task_malloc(sz)
+#define scratch_free(ptr) task_free(ptr)
+#endif
+
+// holds the Buffer methods, shared by all buffer objects
+static jerry_value_t zjs_buffer_prototype = 0;
 
-static zjs_buffer_t *zjs_buffers = NULL;
+// the address of this tags native handles that are buffer structs
+static const char zjs_buffer_tag = 0;
 
-// TODO: this could probably be replaced more efficiently now that there is a
-//   get_native_handle API
 zjs_buffer_t *zjs_buffer_find(const jerry_value_t obj)
 {
     // requires: obj should be the JS object associated with a buffer, created
     //             in zjs_buffer
-    //  effects: looks up obj in our list of known buffer objects and returns
-    //             the associated list item struct
-    for (zjs_buffer_t *buf = zjs_buffers; buf; buf = buf->next)
-        if (buf->obj == obj)
+    //  effects: returns the buffer struct stored as the native handle of obj,
+    //             or NULL if obj is not a buffer
+    uintptr_t handle;
+    if (jerry_value_is_object(obj) &&
+        jerry_get_object_native_handle(obj, &handle)) {
+        // objects of other types have native handles too, so check the tag
+        //   before reading anything else; every handle is a pointer to a
+        //   struct at least a pointer in size
+        zjs_buffer_t *buf = (zjs_buffer_t *)handle;
+        if (buf && buf->tag == &zjs_buffer_tag && buf->obj == obj)
             return buf;
+    }
     return NULL;
 }
 
-static jerry_value_t zjs_buffer_read_bytes(const jerry_value_t this,
-                                           const jerry_value_t argv[],
-                                           const jerry_length_t argc,
-                                           int bytes, bool big_endian)
+static bool zjs_buffer_arg_offset(const jerry_value_t argv[],
+                                  const jerry_length_t argc, int index,
+                                  uint32_t def, uint32_t *offset)
 {
-    // requires: this is a JS buffer object created with zjs_buffer_create,
-    //             argv[0] should be an offset into the buffer, but will treat
-    //             offset as 0 if not given, as node.js seems to
-    //           bytes is the number of bytes to read (expects 1, 2, or 4)
-    //           big_endian true reads the bytes in big endian order, false in
-    //             little endian order
-    //  effects: reads bytes from the buffer associated with this JS object, if
-    //             found, at the given offset, if within the bounds of the
-    //             buffer; otherwise returns an error
-    if (argc >= 1 && !jerry_value_is_number(argv[0]))
-        return zjs_error("zjs_buffer_read_bytes: invalid argument");
-
-    uint32_t offset = 0;
-    if (argc >= 1)
-        offset = (uint32_t)jerry_get_number_value(argv[0]);
-
-    zjs_buffer_t *buf = zjs_buffer_find(this);
-    if (!buf)
-        return zjs_error("zjs_buffer_read_bytes: buffer not found on read");
+    // requires: offset is where to store the result
+    //  effects: reads the optional argument at index as a byte offset into
+    //             *offset, using def if it is missing or undefined; returns
+    //             false if it is given but isn't a non-negative number
+    if (argc <= index || jerry_value_is_undefined(argv[index])) {
+        *offset = def;
+        return true;
+    }
+    if (!jerry_value_is_number(argv[index]))
+        return false;
+
+    double num = jerry_get_number_value(argv[index]);
+    if (!(num >= 0))
+        return false;
+    *offset = num > UINT32_MAX ? UINT32_MAX : (uint32_t)num;
+    return true;
+}
 
-    if (offset + bytes > buf->bufsize)
-        return zjs_error("zjs_buffer_read_bytes: read attempted beyond buffer");
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ZJS_HOST_BIG_ENDIAN true
+#else
+#define ZJS_HOST_BIG_ENDIAN false
+#endif
 
-    int dir = big_endian ? 1 : -1;
-    if (!big_endian)
-        offset += bytes - 1;  // start on the big end
+enum zjs_buffer_type {
+    ZJS_TYPE_UINT8,
+    ZJS_TYPE_INT8,
+    ZJS_TYPE_UINT16,
+    ZJS_TYPE_INT16,
+    ZJS_TYPE_UINT32,
+    ZJS_TYPE_INT32,
+    ZJS_TYPE_FLOAT,
+    ZJS_TYPE_DOUBLE
+};
+
+// one numeric type with a byte order, read and written by the readX/writeX
+//   methods named after it
+typedef struct zjs_buffer_accessor {
+    const char *name;
+    uint8_t type;
+    uint8_t size;
+    bool big_endian;
+} zjs_buffer_accessor_t;
+
+static const zjs_buffer_accessor_t zjs_buffer_accessors[] = {
+    { "UInt8", ZJS_TYPE_UINT8, 1, false },
+    { "Int8", ZJS_TYPE_INT8, 1, false },
+    { "UInt16BE", ZJS_TYPE_UINT16, 2, true },
+    { "UInt16LE", ZJS_TYPE_UINT16, 2, false },
+    { "Int16BE", ZJS_TYPE_INT16, 2, true },
+    { "Int16LE", ZJS_TYPE_INT16, 2, false },
+    { "UInt32BE", ZJS_TYPE_UINT32, 4, true },
+    { "UInt32LE", ZJS_TYPE_UINT32, 4, false },
+    { "Int32BE", ZJS_TYPE_INT32, 4, true },
+    { "Int32LE", ZJS_TYPE_INT32, 4, false },
+    { "FloatBE", ZJS_TYPE_FLOAT, 4, true },
+    { "FloatLE", ZJS_TYPE_FLOAT, 4, false },
+    { "DoubleBE", ZJS_TYPE_DOUBLE, 8, true },
+    { "DoubleLE", ZJS_TYPE_DOUBLE, 8, false },
+    { NULL }
+};
+
+// longest accessor name plus a "write" prefix
+#define ZJS_ACCESSOR_NAME_SIZE 16
+
+// load and store size bits in the given byte order; memcpy keeps unaligned
+//   offsets safe and compiles down to a plain load or store, and the swap is
+//   a single instruction on targets that have one
+#define ZJS_LOAD(bits, src, big_endian) ({                  \
+    uint##bits##_t zjs_val;                                 \
+    memcpy(&zjs_val, src, sizeof(zjs_val));                 \
+    (big_endian) != ZJS_HOST_BIG_ENDIAN ?                   \
+        __builtin_bswap##bits(zjs_val) : zjs_val; })
+
+#define ZJS_STORE(bits, dst, big_endian, value) ({          \
+    uint##bits##_t zjs_val = value;                         \
+    if ((big_endian) != ZJS_HOST_BIG_ENDIAN)                \
+        zjs_val = __builtin_bswap##bits(zjs_val);           \
+    memcpy(dst, &zjs_val, sizeof(zjs_val)); })
+
+static double zjs_buffer_load(const uint8_t *src,
+                              const zjs_buffer_accessor_t *acc)
+{
+    // requires: src has acc->size bytes
+    //  effects: returns the value of type acc stored at src
+    switch (acc->type) {
+    case ZJS_TYPE_UINT8:
+        return src[0];
+    case ZJS_TYPE_INT8:
+        return (int8_t)src[0];
+    case ZJS_TYPE_UINT16:
+        return ZJS_LOAD(16, src, acc->big_endian);
+    case ZJS_TYPE_INT16:
+        return (int16_t)ZJS_LOAD(16, src, acc->big_endian);
+    case ZJS_TYPE_UINT32:
+        return ZJS_LOAD(32, src, acc->big_endian);
+    case ZJS_TYPE_INT32:
+        return (int32_t)ZJS_LOAD(32, src, acc->big_endian);
+    case ZJS_TYPE_FLOAT: {
+        uint32_t bits = ZJS_LOAD(32, src, acc->big_endian);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    default: {
+        uint64_t bits = ZJS_LOAD(64, src, acc->big_endian);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    }
+}
 
-    uint32_t value = 0;
-    for (int i = 0; i < bytes; i++) {
-        value <<= 8;
-        value |= buf->buffer[offset];
-        offset += dir;
+static void zjs_buffer_store(uint8_t *dst, const zjs_buffer_accessor_t *acc,
+                             double value)
+{
+    // requires: dst has room for acc->size bytes
+    //  effects: stores value at dst as type acc; integers are truncated and
+    //             wrap around like node.js does without its range checks,
+    //             except that negative values store 0 for unsigned types
+    if (acc->type == ZJS_TYPE_FLOAT) {
+        float fvalue = value;
+        uint32_t bits;
+        memcpy(&bits, &fvalue, sizeof(bits));
+        ZJS_STORE(32, dst, acc->big_endian, bits);
+        return;
+    }
+    if (acc->type == ZJS_TYPE_DOUBLE) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        ZJS_STORE(64, dst, acc->big_endian, bits);
+        return;
     }
 
-    return jerry_create_number(value);
+    // converting an out of range double straight to an integer is undefined,
+    //   so go through int64 and treat NaN and huge values as 0
+    uint32_t ivalue = 0;
+    bool is_signed = acc->type == ZJS_TYPE_INT8 ||
+                     acc->type == ZJS_TYPE_INT16 ||
+                     acc->type == ZJS_TYPE_INT32;
+    if (value > (is_signed ? -9.2e18 : 0) && value < 9.2e18)
+        ivalue = (uint32_t)(int64_t)value;
+
+    if (acc->size == 1)
+        dst[0] = ivalue;
+    else if (acc->size == 2)
+        ZJS_STORE(16, dst, acc->big_endian, ivalue);
+    else
+        ZJS_STORE(32, dst, acc->big_endian, ivalue);
 }
 
-static jerry_value_t zjs_buffer_write_bytes(const jerry_value_t this,
-                                            const jerry_value_t argv[],
-                                            const jerry_length_t argc,
-                                            int bytes, bool big_endian)
+static const zjs_buffer_accessor_t *zjs_buffer_get_accessor(jerry_value_t func)
 {
-    // requires: this is a JS buffer object created with zjs_buffer_create,
-    //             argv[0] must be the value to be written, argv[1] should be
-    //             an offset into the buffer, but will treat offset as 0 if not
-    //             given, as node.js seems to
-    //           bytes is the number of bytes to write (expects 1, 2, or 4)
-    //           big_endian true writes the bytes in big endian order, false in
-    //             little endian order
-    //  effects: writes bytes into the buffer associated with this JS object, if
-    //             found, at the given offset, if within the bounds of the
-    //             buffer; otherwise returns an error
-    if (argc < 1 || !jerry_value_is_number(argv[0]) ||
-        (argc >= 2 && !jerry_value_is_number(argv[1]))) {
-        return zjs_error("zjs_buffer_write_bytes: invalid argument");
-    }
+    // requires: func is a function object added by zjs_buffer_add_accessor
+    //  effects: returns the accessor it reads or writes
+    uintptr_t handle;
+    if (jerry_get_object_native_handle(func, &handle))
+        return (const zjs_buffer_accessor_t *)handle;
+    return NULL;
+}
 
-    uint32_t value = jerry_get_number_value(argv[0]);
+static bool zjs_buffer_check_range(zjs_buffer_t *buf, uint32_t offset,
+                                   uint32_t bytes)
+{
+    //  effects: returns true if bytes bytes at offset are within buf
+    return offset <= buf->bufsize && bytes <= buf->bufsize - offset;
+}
 
-    uint32_t offset = 0;
-    if (argc > 1)
-        offset = (uint32_t)jerry_get_number_value(argv[1]);
+static jerry_value_t zjs_buffer_read(const jerry_value_t function_obj,
+                                     const jerry_value_t this,
+                                     const jerry_value_t argv[],
+                                     const jerry_length_t argc)
+{
+    // requires: function_obj is one of the readX methods, this is a JS buffer
+    //             object created with zjs_buffer_create, argv[0] should be an
+    //             offset into the buffer, but will treat offset as 0 if not
+    //             given, as node.js seems to
+    //  effects: reads a value of the method's type from the buffer associated
+    //             with this JS object, if found, at the given offset, if
+    //             within the bounds of the buffer; otherwise returns an error
+    const zjs_buffer_accessor_t *acc = zjs_buffer_get_accessor(function_obj);
+    uint32_t offset;
+    if (!acc || !zjs_buffer_arg_offset(argv, argc, 0, 0, &offset))
+        return zjs_error("zjs_buffer_read: invalid argument");
 
     zjs_buffer_t *buf = zjs_buffer_find(this);
     if (!buf)
-        return zjs_error("zjs_buffer_write_bytes: buffer not found on write");
+        return zjs_error("zjs_buffer_read: buffer not found on read");
 
-    if (offset + bytes > buf->bufsize)
-        return zjs_error("zjs_buffer_write_bytes: write attempted beyond buffer");
+    if (!zjs_buffer_check_range(buf, offset, acc->size))
+        return zjs_error("zjs_buffer_read: read attempted beyond buffer");
 
-    int dir = big_endian ? -1 : 1;
-    if (big_endian)
-        offset += bytes - 1;  // start on the little end
+    return jerry_create_number(zjs_buffer_load(buf->buffer + offset, acc));
+}
 
-    for (int i = 0; i < bytes; i++) {
-        buf->buffer[offset] = value & 0xff;
-        value >>= 8;
-        offset += dir;
+static jerry_value_t zjs_buffer_write(const jerry_value_t function_obj,
+                                      const jerry_value_t this,
+                                      const jerry_value_t argv[],
+                                      const jerry_length_t argc)
+{
+    // requires: function_obj is one of the writeX methods, this is a JS buffer
+    //             object created with zjs_buffer_create, argv[0] must be the
+    //             value to be written, argv[1] should be an offset into the
+    //             buffer, but will treat offset as 0 if not given, as node.js
+    //             seems to
+    //  effects: writes the value as the method's type into the buffer
+    //             associated with this JS object, if found, at the given
+    //             offset, if within the bounds of the buffer; otherwise
+    //             returns an error
+    const zjs_buffer_accessor_t *acc = zjs_buffer_get_accessor(function_obj);
+    uint32_t offset;
+    if (!acc || argc < 1 || !jerry_value_is_number(argv[0]) ||
+        !zjs_buffer_arg_offset(argv, argc, 1, 0, &offset)) {
+        return zjs_error("zjs_buffer_write: invalid argument");
     }
 
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("zjs_buffer_write: buffer not found on write");
+
+    if (!zjs_buffer_check_range(buf, offset, acc->size))
+        return zjs_error("zjs_buffer_write: write attempted beyond buffer");
+
+    zjs_buffer_store(buf->buffer + offset, acc,
+                     jerry_get_number_value(argv[0]));
     return ZJS_UNDEFINED;
 }
 
-static jerry_value_t zjs_buffer_read_uint8(const jerry_value_t function_obj,
+static jerry_value_t zjs_buffer_read_array(const jerry_value_t function_obj,
                                            const jerry_value_t this,
                                            const jerry_value_t argv[],
                                            const jerry_length_t argc)
 {
-    return zjs_buffer_read_bytes(this, argv, argc, 1, true);
-}
+    // requires: this is a JS buffer object, argv[0] is the name of a type as
+    //             used by the readX methods, e.g. 'Int16LE', argv[1] the offset
+    //             to start at (default 0), argv[2] the number of values to
+    //             read (default as many as fit)
+    //  effects: returns an array of count values of the given type, read one
+    //             after another starting at offset, or an error if they
+    //             don't all fit in the buffer
+    if (argc < 1 || !jerry_value_is_string(argv[0]))
+        return zjs_error("zjs_buffer_read_array: invalid argument");
+
+    char type[ZJS_ACCESSOR_NAME_SIZE];
+    jerry_size_t sz = jerry_get_string_size(argv[0]);
+    if (sz >= ZJS_ACCESSOR_NAME_SIZE)
+        return zjs_error("zjs_buffer_read_array: unknown type");
+    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)type, sz);
+    type[len] = '\0';
 
-static jerry_value_t zjs_buffer_read_uint16_be(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
-{
-    return zjs_buffer_read_bytes(this, argv, argc, 2, true);
-}
+    const zjs_buffer_accessor_t *acc = zjs_buffer_accessors;
+    while (acc->name && strcmp(acc->name, type))
+        acc++;
+    if (!acc->name)
+        return zjs_error("zjs_buffer_read_array: unknown type");
 
-static jerry_value_t zjs_buffer_read_uint16_le(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
-{
-    return zjs_buffer_read_bytes(this, argv, argc, 2, false);
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("zjs_buffer_read_array: buffer not found");
+
+    uint32_t offset, count;
+    if (!zjs_buffer_arg_offset(argv, argc, 1, 0, &offset))
+        return zjs_error("zjs_buffer_read_array: invalid argument");
+    uint32_t max = offset <= buf->bufsize ?
+        (buf->bufsize - offset) / acc->size : 0;
+    if (!zjs_buffer_arg_offset(argv, argc, 2, max, &count))
+        return zjs_error("zjs_buffer_read_array: invalid argument");
+
+    if (offset > buf->bufsize || count > max)
+        return zjs_error("zjs_buffer_read_array: read attempted beyond buffer");
+
+    jerry_value_t array = jerry_create_array(count);
+    const uint8_t *src = buf->buffer + offset;
+    for (uint32_t i = 0; i < count; i++, src += acc->size) {
+        jerry_value_t value = jerry_create_number(zjs_buffer_load(src, acc));
+        jerry_release_value(jerry_set_property_by_index(array, i, value));
+        jerry_release_value(value);
+    }
+    return array;
 }
 
-static jerry_value_t zjs_buffer_read_uint32_be(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
+static void zjs_buffer_add_accessor(jerry_value_t obj, const char *prefix,
+                                    jerry_external_handler_t handler,
+                                    const zjs_buffer_accessor_t *acc)
 {
-    return zjs_buffer_read_bytes(this, argv, argc, 4, true);
+    // requires: obj is the Buffer prototype, prefix is "read" or "write"
+    //  effects: adds a method named prefix + acc->name that calls handler;
+    //             the accessor rides along as the function object's native
+    //             handle, so one handler serves every type
+    char name[ZJS_ACCESSOR_NAME_SIZE];
+    strcpy(name, prefix);
+    strcat(name, acc->name);
+
+    jerry_value_t func = jerry_create_external_function(handler);
+    jerry_set_object_native_handle(func, (uintptr_t)acc, NULL);
+    zjs_set_property(obj, name, func);
+    jerry_release_value(func);
 }
 
-static jerry_value_t zjs_buffer_read_uint32_le(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
+enum zjs_buffer_encoding {
+    ZJS_ENCODING_UTF8,
+    ZJS_ENCODING_HEX,
+    ZJS_ENCODING_BASE64,
+    ZJS_ENCODING_UNKNOWN
+};
+
+static const char zjs_hex_digits[] = "0123456789abcdef";
+static const char zjs_base64_digits[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// value of each 7-bit character as a hex digit, or -1 if it isn't one
+static const int8_t zjs_hex_values[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+// value of each 7-bit character as a base64 digit, or -1 if it isn't one;
+//   like node.js, accepts the URL-safe '-' and '_' as well as '+' and '/'
+static const int8_t zjs_base64_values[128] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, 62, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, 63,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+};
+
+#define HEX_VALUE(c) ((c) < 128 ? zjs_hex_values[c] : -1)
+#define BASE64_VALUE(c) ((c) < 128 ? zjs_base64_values[c] : -1)
+
+static enum zjs_buffer_encoding zjs_buffer_get_encoding(jerry_value_t arg)
 {
-    return zjs_buffer_read_bytes(this, argv, argc, 4, false);
-}
+    // requires: arg is a JS string
+    //  effects: returns the encoding named by arg, or ZJS_ENCODING_UNKNOWN
+    const int maxlen = 8;
+    char encoding[maxlen];
+    jerry_size_t sz = jerry_get_string_size(arg);
+    if (sz >= maxlen)
+        return ZJS_ENCODING_UNKNOWN;
+    int len = jerry_string_to_char_buffer(arg, (jerry_char_t *)encoding, sz);
+    encoding[len] = '\0';
 
-static jerry_value_t zjs_buffer_write_uint8(const jerry_value_t function_obj,
-                                           const jerry_value_t this,
-                                           const jerry_value_t argv[],
-                                           const jerry_length_t argc)
-{
-    return zjs_buffer_write_bytes(this, argv, argc, 1, true);
+    if (!strcmp(encoding, "utf8") || !strcmp(encoding, "utf-8"))
+        return ZJS_ENCODING_UTF8;
+    if (!strcmp(encoding, "hex"))
+        return ZJS_ENCODING_HEX;
+    if (!strcmp(encoding, "base64"))
+        return ZJS_ENCODING_BASE64;
+    return ZJS_ENCODING_UNKNOWN;
 }
 
-static jerry_value_t zjs_buffer_write_uint16_be(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
+static uint32_t zjs_hex_encode(const uint8_t *src, uint32_t len, char *dst)
 {
-    return zjs_buffer_write_bytes(this, argv, argc, 2, true);
+    // requires: dst has room for len * 2 characters
+    //  effects: writes src to dst as lowercase hex digits, returns the number
+    //             of characters written
+    for (uint32_t i = 0; i < len; i++) {
+        *dst++ = zjs_hex_digits[src[i] >> 4];
+        *dst++ = zjs_hex_digits[src[i] & 0xf];
+    }
+    return len * 2;
 }
 
-static jerry_value_t zjs_buffer_write_uint16_le(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
+static uint32_t zjs_hex_decode(const uint8_t *src, uint32_t len, uint8_t *dst,
+                               uint32_t max)
 {
-    return zjs_buffer_write_bytes(this, argv, argc, 2, false);
+    // requires: dst has room for max bytes; it may be src itself
+    //  effects: decodes pairs of hex digits from src into dst, until src or
+    //             dst runs out or, like node.js, an invalid pair is found;
+    //             returns the number of bytes written
+    uint32_t count = 0;
+    for (uint32_t i = 0; i + 1 < len && count < max; i += 2) {
+        int high = HEX_VALUE(src[i]);
+        int low = HEX_VALUE(src[i + 1]);
+        if (high < 0 || low < 0)
+            break;
+        dst[count++] = (high << 4) | low;
+    }
+    return count;
 }
 
-static jerry_value_t zjs_buffer_write_uint32_be(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
+static uint32_t zjs_base64_encode(const uint8_t *src, uint32_t len, char *dst)
 {
-    return zjs_buffer_write_bytes(this, argv, argc, 4, true);
+    // requires: dst has room for (len + 2) / 3 * 4 characters
+    //  effects: writes src to dst in base64 with '=' padding, returns the
+    //             number of characters written
+    char *start = dst;
+    uint32_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t bits = src[i] << 16 | src[i + 1] << 8 | src[i + 2];
+        *dst++ = zjs_base64_digits[bits >> 18];
+        *dst++ = zjs_base64_digits[(bits >> 12) & 0x3f];
+        *dst++ = zjs_base64_digits[(bits >> 6) & 0x3f];
+        *dst++ = zjs_base64_digits[bits & 0x3f];
+    }
+    if (i < len) {
+        uint32_t bits = src[i] << 16;
+        if (i + 1 < len)
+            bits |= src[i + 1] << 8;
+        *dst++ = zjs_base64_digits[bits >> 18];
+        *dst++ = zjs_base64_digits[(bits >> 12) & 0x3f];
+        *dst++ = i + 1 < len ? zjs_base64_digits[(bits >> 6) & 0x3f] : '=';
+        *dst++ = '=';
+    }
+    return dst - start;
 }
 
-static jerry_value_t zjs_buffer_write_uint32_le(const jerry_value_t function_obj,
-                                               const jerry_value_t this,
-                                               const jerry_value_t argv[],
-                                               const jerry_length_t argc)
+static uint32_t zjs_base64_decode(const uint8_t *src, uint32_t len,
+                                  uint8_t *dst, uint32_t max)
 {
-    return zjs_buffer_write_bytes(this, argv, argc, 4, false);
+    // requires: dst has room for max bytes; it may be src itself
+    //  effects: decodes base64 from src into dst until src or dst runs out or
+    //             padding is reached; like node.js, skips characters that
+    //             aren't base64 digits, such as whitespace; returns the
+    //             number of bytes decoded
+    uint32_t count = 0, bits = 0;
+    int nbits = 0;
+    for (uint32_t i = 0; i < len && src[i] != '=' && count < max; i++) {
+        int value = BASE64_VALUE(src[i]);
+        if (value < 0)
+            continue;
+        bits = bits << 6 | value;
+        nbits += 6;
+        if (nbits >= 8) {
+            nbits -= 8;
+            dst[count++] = bits >> nbits;
+        }
+    }
+    return count;
 }
 
-char zjs_int_to_hex(int value) {
-    // requires: value is between 0 and 15
-    //  effects: returns value as a lowercase hex digit 0-9a-f
-    if (value < 10)
-        return '0' + value;
-    return 'a' + value - 10;
+static uint32_t zjs_buffer_decode(enum zjs_buffer_encoding encoding,
+                                  const uint8_t *src, uint32_t len,
+                                  uint8_t *dst, uint32_t max)
+{
+    // requires: encoding is hex, base64 or utf8; dst has room for max bytes
+    //             and may be src itself
+    //  effects: decodes src into dst, returns the number of bytes written
+    if (encoding == ZJS_ENCODING_HEX)
+        return zjs_hex_decode(src, len, dst, max);
+    if (encoding == ZJS_ENCODING_BASE64)
+        return zjs_base64_decode(src, len, dst, max);
+    if (len > max)
+        len = max;
+    memmove(dst, src, len);
+    return len;
 }
 
 static jerry_value_t zjs_buffer_to_string(const jerry_value_t function_obj,
@@ -212,10 +521,10 @@ static jerry_value_t zjs_buffer_to_string(const jerry_value_t function_obj,
                                           const jerry_length_t argc)
 {
     // requires: this must be a JS buffer object, if an argument is present it
-    //             must be the string 'hex', as that is the only supported
-    //             encoding for now
-    //  effects: if the buffer object is found, converts its contents to a hex
-    //             string and returns it in ret_val_p
+    //             must be the string 'hex' or 'base64', the supported
+    //             encodings for now
+    //  effects: if the buffer object is found, encodes its contents into a
+    //             scratch string in one pass and returns it as a JS string
     if (argc > 1 || (argc == 1 && !jerry_value_is_string(argv[0])))
         return zjs_error("zjs_buffer_to_string: invalid argument");
 
@@ -224,132 +533,536 @@ static jerry_value_t zjs_buffer_to_string(const jerry_value_t function_obj,
         return jerry_create_string((jerry_char_t *)"[Buffer Object]");
     }
 
-    const int maxlen = 16;
-    char encoding[maxlen];
-    jerry_size_t sz = jerry_get_string_size(argv[0]);
-    if (sz >= maxlen) {
-        return zjs_error("zjs_buffer_to_string: encoding argument too long");
-    }
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)encoding,
-                                          sz);
-    encoding[len] = '\0';
-
-    if (strcmp(encoding, "hex"))
+    enum zjs_buffer_encoding encoding = zjs_buffer_get_encoding(argv[0]);
+    if (encoding != ZJS_ENCODING_HEX && encoding != ZJS_ENCODING_BASE64)
         return zjs_error("zjs_buffer_to_string: unsupported encoding type");
 
-    if (buf && buf->bufsize > 0) {
-        char hexbuf[buf->bufsize * 2 + 1];
-        for (int i=0; i<buf->bufsize; i++) {
-            int high = (0xf0 & buf->buffer[i]) >> 4;
-            int low = 0xf & buf->buffer[i];
-            hexbuf[2*i] = zjs_int_to_hex(high);
-            hexbuf[2*i+1] = zjs_int_to_hex(low);
-        }
-        hexbuf[buf->bufsize * 2] = '\0';
-        return jerry_create_string((jerry_char_t *)hexbuf);
+    if (!buf)
+        return zjs_error("zjs_buffer_to_string: buffer not found");
+
+    uint32_t size;
+    if (encoding == ZJS_ENCODING_HEX)
+        size = buf->bufsize * 2;
+    else
+        size = (buf->bufsize + 2) / 3 * 4;
+
+    char *str = (char *)scratch_malloc(size + 1);
+    if (!str)
+        return zjs_error("zjs_buffer_to_string: out of memory");
+
+    if (encoding == ZJS_ENCODING_HEX)
+        size = zjs_hex_encode(buf->buffer, buf->bufsize, str);
+    else
+        size = zjs_base64_encode(buf->buffer, buf->bufsize, str);
+    str[size] = '\0';
+
+    jerry_value_t result = jerry_create_string((jerry_char_t *)str);
+    scratch_free(str);
+    return result;
+}
+
+static jerry_value_t zjs_buffer_to_json(const jerry_value_t function_obj,
+                                        const jerry_value_t this,
+                                        const jerry_value_t argv[],
+                                        const jerry_length_t argc)
+{
+    // requires: this must be a JS buffer object
+    //  effects: returns an object like node.js does, { type: 'Buffer',
+    //             data: [...] }, with the bytes copied into a plain array in
+    //             one call; JSON.stringify uses this, and code that wants to
+    //             index the bytes as data[i] can too
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("zjs_buffer_to_json: buffer not found");
+
+    jerry_value_t data = jerry_create_array(buf->bufsize);
+    for (uint32_t i = 0; i < buf->bufsize; i++) {
+        jerry_value_t value = jerry_create_number(buf->buffer[i]);
+        jerry_release_value(jerry_set_property_by_index(data, i, value));
+        jerry_release_value(value);
     }
 
-    return zjs_error("zjs_buffer_to_string: buffer is empty");
+    jerry_value_t result = jerry_create_object();
+    zjs_obj_add_string(result, "Buffer", "type");
+    zjs_obj_add_object(result, data, "data");
+    jerry_release_value(data);
+    return result;
 }
 
 static void zjs_buffer_callback_free(uintptr_t handle)
 {
     // requires: handle is the native pointer we registered with
     //             jerry_set_object_native_handle
-    //  effects: frees the callback list item for the given pin object
-    zjs_buffer_t **pItem = &zjs_buffers;
-    while (*pItem) {
-        if ((uintptr_t)*pItem == handle) {
-            zjs_free((*pItem)->buffer);
-            *pItem = (*pItem)->next;
-            zjs_free((void *)handle);
-        }
-        pItem = &(*pItem)->next;
+    //  effects: frees the buffer and its struct once the object is collected;
+    //             a slice only drops its reference to the buffer it shares
+    zjs_buffer_t *buf = (zjs_buffer_t *)handle;
+    if (buf) {
+        if (buf->parent)
+            jerry_release_value(buf->parent);
+        else
+            zjs_free(buf->buffer);
+        zjs_free(buf);
     }
 }
 
-static jerry_value_t zjs_buffer_write_string(const jerry_value_t function_obj_val,
-                                             const jerry_value_t this,
-                                             const jerry_value_t argv[],
-                                             const jerry_length_t argc)
+static void zjs_buffer_setup(jerry_value_t buf_obj, zjs_buffer_t *buf_item)
 {
-    // requires: string - what will be written to buf
-    //           offset - where to start writing (Default: 0)
-    //           length - how many bytes to write (Default: buf.length -offset)
-    //           encoding - the character encoding of string. Currently only supports
-    //           the default of utf8
-    // effects: writes string to buf at offset according to the character encoding in encoding.
-
-    if (argc < 1 || !jerry_value_is_string(argv[0]) ||
-        (argc > 1 && !jerry_value_is_number(argv[1])) ||
-        (argc > 2 && !jerry_value_is_number(argv[2])) ||
-        (argc > 3 && !jerry_value_is_string(argv[3])))
-        return zjs_error("zjs_buffer_write_string: invalid argument");
+    // requires: buf_obj is a new JS object, buf_item is filled in for it
+    //  effects: makes buf_obj a Buffer backed by buf_item
+    buf_item->tag = &zjs_buffer_tag;
+    buf_item->obj = buf_obj;
+
+    jerry_value_t jsize = jerry_create_number(buf_item->bufsize);
+    jerry_set_property(buf_obj, ZJS_NAME(length), jsize);
+    jerry_release_value(jsize);
+    jerry_release_value(jerry_set_prototype(buf_obj, zjs_buffer_prototype));
+
+    // watch for the object getting garbage collected, and clean up
+    jerry_set_object_native_handle(buf_obj, (uintptr_t)buf_item,
+                                   zjs_buffer_callback_free);
+}
+
+static uint32_t zjs_buffer_slice_offset(jerry_value_t arg, uint32_t size)
+{
+    // requires: arg is a number
+    //  effects: returns arg as an offset into a buffer of length size; like
+    //             node.js, negative offsets count back from the end, and the
+    //             result is clamped to the buffer; NaN counts as 0
+    double offset = jerry_get_number_value(arg);
+    if (isnan(offset))
+        return 0;
+    if (offset < 0)
+        offset += size;
+    if (offset < 0)
+        return 0;
+    if (offset > size)
+        return size;
+    return (uint32_t)offset;
+}
+
+static jerry_value_t zjs_buffer_slice(const jerry_value_t function_obj,
+                                      const jerry_value_t this,
+                                      const jerry_value_t argv[],
+                                      const jerry_length_t argc)
+{
+    // requires: this is a JS buffer object created with zjs_buffer_create,
+    //             argv[0] is the start offset, defaulting to 0, and argv[1]
+    //             the end offset, defaulting to the buffer length
+    //  effects: returns a new Buffer that shares the memory of this one from
+    //             start up to end, without copying, so changes to either show
+    //             up in both; the memory lives until all of them are collected
+    if ((argc >= 1 && !jerry_value_is_number(argv[0])) ||
+        (argc >= 2 && !jerry_value_is_number(argv[1])))
+        return zjs_error("zjs_buffer_slice: invalid argument");
 
-    // Check if the encoding string is anything other than utf8
-    if (argc > 3) {
-        jerry_value_t arg4 = argv[3];
-        jerry_size_t arg4_sz = jerry_get_string_size(arg4);
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("zjs_buffer_slice: buffer not found");
 
-        if (arg4_sz > 4096) {
-            return zjs_error("zjs_buffer_write_string: encoding arg string is too long");
+    uint32_t start = 0, end = buf->bufsize;
+    if (argc >= 1)
+        start = zjs_buffer_slice_offset(argv[0], buf->bufsize);
+    if (argc >= 2)
+        end = zjs_buffer_slice_offset(argv[1], buf->bufsize);
+    if (end < start)
+        end = start;
+
+    zjs_buffer_t *view = (zjs_buffer_t *)zjs_malloc(sizeof(zjs_buffer_t));
+    if (!view)
+        return zjs_error("zjs_buffer_slice: unable to allocate buffer");
+
+    // point straight at the buffer that owns the memory, so slices of slices
+    //   don't keep a chain of objects alive
+    view->parent = jerry_acquire_value(buf->parent ? buf->parent : this);
+    view->buffer = buf->buffer + start;
+    view->bufsize = end - start;
+
+    jerry_value_t view_obj = jerry_create_object();
+    zjs_buffer_setup(view_obj, view);
+    return view_obj;
+}
+
+static uint8_t zjs_buffer_number_byte(double num)
+{
+    //  effects: returns num modulo 256 like a Uint8Array store does, with NaN
+    //             and infinities as 0; every double of 2^53 or more in
+    //             magnitude is a multiple of 256, so those are 0 too, and
+    //             everything else fits an int64_t
+    if (!(num > -9007199254740992.0 && num < 9007199254740992.0))
+        return 0;
+    return (uint8_t)((int64_t)num & 0xff);
+}
+
+static bool zjs_buffer_get_bytes(jerry_value_t value, uint8_t *byte,
+                                 const uint8_t **data, uint32_t *len,
+                                 uint8_t **heap)
+{
+    // requires: byte points to scratch space for a single byte
+    //  effects: gets the bytes of value, which may be a number (one byte,
+    //             taken modulo 256), a string (its UTF-8 bytes) or a Buffer,
+    //             in *data and *len; if a copy had to be made it is returned
+    //             in *heap and must be freed with zjs_free, otherwise *heap
+    //             is NULL; returns false if value has any other type or
+    //             memory runs out
+    *heap = NULL;
+    if (jerry_value_is_number(value)) {
+        *byte = zjs_buffer_number_byte(jerry_get_number_value(value));
+        *data = byte;
+        *len = 1;
+        return true;
+    }
+
+    if (jerry_value_is_string(value)) {
+        jerry_size_t sz = jerry_get_string_size(value);
+        if (sz > 0) {
+            *heap = (uint8_t *)zjs_malloc(sz);
+            if (!*heap)
+                return false;
+            jerry_string_to_char_buffer(value, (jerry_char_t *)*heap, sz);
         }
+        *data = *heap;
+        *len = sz;
+        return true;
+    }
+
+    zjs_buffer_t *buf = zjs_buffer_find(value);
+    if (buf) {
+        *data = buf->buffer;
+        *len = buf->bufsize;
+        return true;
+    }
+    return false;
+}
 
-        char arg4_str[arg4_sz];
-        char utf8_str[4];
-        strcpy(utf8_str, "utf8");
-        uint8_t utf8 = strcmp(arg4_str, utf8_str);
+static jerry_value_t zjs_buffer_copy(const jerry_value_t function_obj,
+                                     const jerry_value_t this,
+                                     const jerry_value_t argv[],
+                                     const jerry_length_t argc)
+{
+    // requires: this is a JS buffer object, argv[0] is the target Buffer,
+    //             argv[1] the offset in the target to start writing at
+    //             (default 0), argv[2] and argv[3] the source start and end
+    //             offsets (default 0 and this.length)
+    //  effects: copies as many bytes as fit from this buffer into the target
+    //             with a single memmove, so the two may overlap, e.g. slices
+    //             of the same buffer; returns the number of bytes copied
+    zjs_buffer_t *src = zjs_buffer_find(this);
+    zjs_buffer_t *dst = argc >= 1 ? zjs_buffer_find(argv[0]) : NULL;
+    if (!src || !dst)
+        return zjs_error("zjs_buffer_copy: invalid argument");
+
+    uint32_t target_start, source_start, source_end;
+    if (!zjs_buffer_arg_offset(argv, argc, 1, 0, &target_start) ||
+        !zjs_buffer_arg_offset(argv, argc, 2, 0, &source_start) ||
+        !zjs_buffer_arg_offset(argv, argc, 3, src->bufsize, &source_end))
+        return zjs_error("zjs_buffer_copy: invalid argument");
+
+    if (source_end > src->bufsize)
+        source_end = src->bufsize;
+    if (target_start > dst->bufsize || source_start > source_end)
+        return zjs_error("zjs_buffer_copy: offset out of range");
+
+    uint32_t len = source_end - source_start;
+    if (len > dst->bufsize - target_start)
+        len = dst->bufsize - target_start;
+    memmove(dst->buffer + target_start, src->buffer + source_start, len);
+    return jerry_create_number(len);
+}
 
-        if (utf8 != 0) {
-            return zjs_error("zjs_buffer_write_string: only utf8 encoding is supported");
+static jerry_value_t zjs_buffer_fill(const jerry_value_t function_obj,
+                                     const jerry_value_t this,
+                                     const jerry_value_t argv[],
+                                     const jerry_length_t argc)
+{
+    // requires: this is a JS buffer object, argv[0] is the value to fill with,
+    //             a number, string or Buffer, argv[1] and argv[2] the start
+    //             and end offsets (default 0 and this.length)
+    //  effects: fills the buffer from start up to end with the value, repeated
+    //             as needed; a number is a single memset, longer patterns are
+    //             copied in doubling chunks; returns this
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("zjs_buffer_fill: buffer not found");
+
+    uint32_t start, end;
+    if (argc < 1 ||
+        !zjs_buffer_arg_offset(argv, argc, 1, 0, &start) ||
+        !zjs_buffer_arg_offset(argv, argc, 2, buf->bufsize, &end))
+        return zjs_error("zjs_buffer_fill: invalid argument");
+    if (start > end || end > buf->bufsize)
+        return zjs_error("zjs_buffer_fill: offset out of range");
+
+    uint8_t byte, *heap;
+    const uint8_t *data;
+    uint32_t len;
+    if (!zjs_buffer_get_bytes(argv[0], &byte, &data, &len, &heap))
+        return zjs_error("zjs_buffer_fill: invalid argument");
+
+    uint8_t *dst = buf->buffer + start;
+    uint32_t size = end - start;
+    if (len == 0) {
+        // node.js fills with zeroes given an empty string or Buffer
+        memset(dst, 0, size);
+    } else if (len == 1) {
+        memset(dst, data[0], size);
+    } else {
+        // seed one copy of the pattern, then keep doubling what's been
+        //   written; the pattern may be this buffer itself, so memmove
+        uint32_t done = len < size ? len : size;
+        memmove(dst, data, done);
+        while (done < size) {
+            uint32_t chunk = done < size - done ? done : size - done;
+            memcpy(dst + done, dst, chunk);
+            done += chunk;
         }
     }
+    if (heap)
+        zjs_free(heap);
+    return jerry_acquire_value(this);
+}
 
-    uint32_t offset = 0;
-    jerry_value_t arg = argv[0];
-    jerry_size_t sz = jerry_get_string_size(arg);
+static int zjs_buffer_compare_bytes(const zjs_buffer_t *a,
+                                    const zjs_buffer_t *b)
+{
+    //  effects: returns -1, 0 or 1 as the contents of a sort before, the same
+    //             as or after those of b, byte by byte, with a shorter buffer
+    //             sorting before a longer one it is a prefix of
+    uint32_t len = a->bufsize < b->bufsize ? a->bufsize : b->bufsize;
+    int cmp = len ? memcmp(a->buffer, b->buffer, len) : 0;
+    if (cmp == 0)
+        cmp = a->bufsize < b->bufsize ? -1 : a->bufsize > b->bufsize;
+    return cmp < 0 ? -1 : cmp > 0;
+}
+
+static jerry_value_t zjs_buffer_equals(const jerry_value_t function_obj,
+                                       const jerry_value_t this,
+                                       const jerry_value_t argv[],
+                                       const jerry_length_t argc)
+{
+    // requires: this is a JS buffer object, argv[0] is another Buffer
+    //  effects: returns true if both buffers hold the same bytes
     zjs_buffer_t *buf = zjs_buffer_find(this);
+    zjs_buffer_t *other = argc >= 1 ? zjs_buffer_find(argv[0]) : NULL;
+    if (!buf || !other)
+        return zjs_error("zjs_buffer_equals: invalid argument");
 
-    if (sz > 4096) {
-        return zjs_error("zjs_buffer_write_string: string is too long for the buffer");
+    return jerry_create_boolean(buf->bufsize == other->bufsize &&
+                                zjs_buffer_compare_bytes(buf, other) == 0);
+}
+
+static jerry_value_t zjs_buffer_compare(const jerry_value_t function_obj,
+                                        const jerry_value_t this,
+                                        const jerry_value_t argv[],
+                                        const jerry_length_t argc)
+{
+    // requires: this is a JS buffer object, argv[0] is another Buffer
+    //  effects: returns -1, 0 or 1 as this buffer sorts before, the same as,
+    //             or after the other one
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    zjs_buffer_t *other = argc >= 1 ? zjs_buffer_find(argv[0]) : NULL;
+    if (!buf || !other)
+        return zjs_error("zjs_buffer_compare: invalid argument");
+
+    return jerry_create_number(zjs_buffer_compare_bytes(buf, other));
+}
+
+static jerry_value_t zjs_buffer_index_of(const jerry_value_t function_obj,
+                                         const jerry_value_t this,
+                                         const jerry_value_t argv[],
+                                         const jerry_length_t argc)
+{
+    // requires: this is a JS buffer object, argv[0] is the value to look for,
+    //             a number, string or Buffer, argv[1] the offset to start
+    //             searching from (default 0)
+    //  effects: returns the offset of the first occurrence of the value's
+    //             bytes at or after the start offset, or -1 if there is none;
+    //             memchr finds each candidate first byte, memcmp checks the
+    //             rest
+    zjs_buffer_t *buf = zjs_buffer_find(this);
+    if (!buf)
+        return zjs_error("zjs_buffer_index_of: buffer not found");
+
+    uint32_t offset;
+    uint8_t byte, *heap;
+    const uint8_t *data;
+    uint32_t len;
+    if (argc < 1 || !zjs_buffer_arg_offset(argv, argc, 1, 0, &offset) ||
+        !zjs_buffer_get_bytes(argv[0], &byte, &data, &len, &heap))
+        return zjs_error("zjs_buffer_index_of: invalid argument");
+
+    int32_t found = -1;
+    if (len == 0) {
+        // like node.js, an empty value is found right at the offset
+        found = offset < buf->bufsize ? offset : buf->bufsize;
+    } else {
+        while (offset < buf->bufsize && len <= buf->bufsize - offset) {
+            const uint8_t *p = memchr(buf->buffer + offset, data[0],
+                                      buf->bufsize - offset - len + 1);
+            if (!p)
+                break;
+            offset = p - buf->buffer;
+            if (memcmp(p + 1, data + 1, len - 1) == 0) {
+                found = offset;
+                break;
+            }
+            offset++;
+        }
+    }
+    if (heap)
+        zjs_free(heap);
+    return jerry_create_number(found);
+}
+
+static jerry_value_t zjs_buffer_concat(const jerry_value_t function_obj,
+                                       const jerry_value_t this,
+                                       const jerry_value_t argv[],
+                                       const jerry_length_t argc)
+{
+    // requires: argv[0] is an array of Buffers, argv[1] the optional total
+    //             length of the result
+    //  effects: returns a new Buffer holding the contents of the listed
+    //             buffers one after another, each copied with one memcpy;
+    //             stops once the total length is reached, and zero-fills any
+    //             space left over after the last buffer
+    if (argc < 1 || !jerry_value_is_array(argv[0]))
+        return zjs_error("zjs_buffer_concat: invalid argument");
+
+    jerry_value_t list = argv[0];
+    uint32_t count = jerry_get_array_length(list);
+
+    // first pass checks the types and adds up the length
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        jerry_value_t item = jerry_get_property_by_index(list, i);
+        zjs_buffer_t *buf = zjs_buffer_find(item);
+        jerry_release_value(item);
+        if (!buf)
+            return zjs_error("zjs_buffer_concat: list must only hold Buffers");
+        sum += buf->bufsize;
+    }
+
+    uint32_t total;
+    if (!zjs_buffer_arg_offset(argv, argc, 1, sum, &total))
+        return zjs_error("zjs_buffer_concat: invalid argument");
+
+    zjs_buffer_t *new_buf;
+    jerry_value_t new_buf_obj = zjs_buffer_create(total, &new_buf);
+    if (!new_buf) {
+        jerry_release_value(new_buf_obj);
+        return zjs_error("zjs_buffer_concat: unable to allocate buffer");
+    }
+
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < count && pos < total; i++) {
+        jerry_value_t item = jerry_get_property_by_index(list, i);
+        zjs_buffer_t *buf = zjs_buffer_find(item);
+        if (buf) {
+            uint32_t len = buf->bufsize;
+            if (len > total - pos)
+                len = total - pos;
+            memcpy(new_buf->buffer + pos, buf->buffer, len);
+            pos += len;
+        }
+        jerry_release_value(item);
     }
+    memset(new_buf->buffer + pos, 0, total - pos);
 
-    char str[sz];
+    return new_buf_obj;
+}
+
+static jerry_value_t zjs_buffer_write_string(const jerry_value_t function_obj_val,
+                                             const jerry_value_t this,
+                                             const jerry_value_t argv[],
+                                             const jerry_length_t argc)
+{
+    // requires: string - what will be written to buf
+    //           offset - where to start writing (Default: 0)
+    //           length - how many bytes to write (Default: buf.length -offset)
+    //           encoding - the character encoding of string: utf8 (default),
+    //             hex or base64; like node.js, it may also be given right
+    //             after string or offset
+    // effects: decodes string according to encoding and writes the bytes to
+    //            buf at offset, stopping at length; returns the number of
+    //            bytes written
+    if (argc < 1 || !jerry_value_is_string(argv[0]))
+        return zjs_error("zjs_buffer_write_string: invalid argument");
 
+    zjs_buffer_t *buf = zjs_buffer_find(this);
     if (!buf) {
         return zjs_error("zjs_buffer_write_string: buffer pointer not found");
     }
 
-    if (argc > 1)
-        offset = (uint32_t)jerry_get_number_value(argv[1]);
+    // numbers fill in offset, then length; a string is the encoding
+    uint32_t nums[2] = { 0, 0 };
+    int num_count = 0;
+    enum zjs_buffer_encoding encoding = ZJS_ENCODING_UTF8;
+    for (int i = 1; i < argc; i++) {
+        if (jerry_value_is_number(argv[i]) && num_count < 2 &&
+            i == num_count + 1) {
+            nums[num_count++] = (uint32_t)jerry_get_number_value(argv[i]);
+        } else if (jerry_value_is_string(argv[i]) && i == argc - 1) {
+            encoding = zjs_buffer_get_encoding(argv[i]);
+            if (encoding == ZJS_ENCODING_UNKNOWN)
+                return zjs_error("zjs_buffer_write_string: unsupported encoding type");
+        } else {
+            return zjs_error("zjs_buffer_write_string: invalid argument");
+        }
+    }
 
-    uint32_t length = buf->bufsize - offset;
+    uint32_t offset = nums[0];
+    if (offset > buf->bufsize) {
+        return zjs_error("zjs_buffer_write_string: offset is outside the buffer");
+    }
 
-    if (argc > 2)
-        length = (uint32_t)jerry_get_number_value(argv[2]);
+    uint32_t length = buf->bufsize - offset;
+    if (num_count > 1)
+        length = nums[1];
 
-    if (offset + length > buf->bufsize) {
+    if (length > buf->bufsize - offset) {
         return zjs_error("zjs_buffer_write_string: string + offset is larger than the buffer");
     }
 
-    jerry_string_to_char_buffer(arg, str, sz);
+    jerry_value_t arg = argv[0];
+    jerry_size_t sz = jerry_get_string_size(arg);
+    uint8_t *dst = buf->buffer + offset;
+
+    if (encoding == ZJS_ENCODING_UTF8 && sz <= length) {
+        // the whole string fits, so copy it straight into the buffer
+        jerry_string_to_char_buffer(arg, (jerry_char_t *)dst, sz);
+        return jerry_create_number(sz);
+    }
+
+    uint8_t *str = (uint8_t *)scratch_malloc(sz);
+    if (sz && !str) {
+        return zjs_error("zjs_buffer_write_string: out of memory");
+    }
 
-    memcpy(&buf->buffer[offset], &str[0], length);
+    jerry_string_to_char_buffer(arg, (jerry_char_t *)str, sz);
+    uint32_t written = zjs_buffer_decode(encoding, str, sz, dst, length);
+    if (str)
+        scratch_free(str);
 
-    return jerry_create_number(length);
+    return jerry_create_number(written);
 }
 
-jerry_value_t zjs_buffer_create(uint32_t size)
+jerry_value_t zjs_buffer_create(uint32_t size, zjs_buffer_t **ret_buf)
 {
-    // requires: size is size of desired buffer, in bytes
+    // requires: size is size of desired buffer, in bytes; ret_buf is NULL or
+    //             a place to return the buffer struct
     //  effects: allocates a JS Buffer object, an underlying C buffer, and a
-    //             list item to track it; if any of these fail, free them all
-    //             and return NULL, otherwise return the JS object
+    //             struct to track it, stored as the object's native handle; if
+    //             any of these fail, free them all and return undefined,
+    //             otherwise return the JS object; the struct, or NULL on
+    //             failure, goes in *ret_buf so callers can fill the buffer
+    //             without looking it up again
     jerry_value_t buf_obj = jerry_create_object();
     void *buf = zjs_malloc(size);
     zjs_buffer_t *buf_item =
         (zjs_buffer_t *)zjs_malloc(sizeof(zjs_buffer_t));
 
+    if (ret_buf)
+        *ret_buf = NULL;
+
     if (!buf_obj || !buf || !buf_item) {
         PRINT("zjs_buffer_create: unable to allocate buffer\n");
         jerry_release_value(buf_obj);
@@ -358,33 +1071,13 @@ jerry_value_t zjs_buffer_create(uint32_t size)
         return ZJS_UNDEFINED;
     }
 
-    buf_item->obj = buf_obj;
     buf_item->buffer = buf;
     buf_item->bufsize = size;
-    buf_item->next = zjs_buffers;
-    zjs_buffers = buf_item;
-
-    zjs_obj_add_number(buf_obj, size, "length");
-    zjs_obj_add_function(buf_obj, zjs_buffer_read_uint8, "readUInt8");
-    zjs_obj_add_function(buf_obj, zjs_buffer_write_uint8, "writeUInt8");
-    zjs_obj_add_function(buf_obj, zjs_buffer_read_uint16_be, "readUInt16BE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_write_uint16_be, "writeUInt16BE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_read_uint16_le, "readUInt16LE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_write_uint16_le, "writeUInt16LE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_read_uint32_be, "readUInt32BE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_write_uint32_be, "writeUInt32BE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_read_uint32_le, "readUInt32LE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_write_uint32_le, "writeUInt32LE");
-    zjs_obj_add_function(buf_obj, zjs_buffer_to_string, "toString");
-    zjs_obj_add_function(buf_obj, zjs_buffer_write_string, "write");
-
-    // TODO: sign up to get callback when the object is freed, then free the
-    //   buffer and remove it from the list
-
-    // watch for the object getting garbage collected, and clean up
-    jerry_set_object_native_handle(buf_obj, (uintptr_t)buf_item,
-                                   zjs_buffer_callback_free);
+    buf_item->parent = 0;
+    zjs_buffer_setup(buf_obj, buf_item);
 
+    if (ret_buf)
+        *ret_buf = buf_item;
     return buf_obj;
 }
 
@@ -394,64 +1087,141 @@ static jerry_value_t zjs_buffer(const jerry_value_t function_obj,
                                 const jerry_value_t argv[],
                                 const jerry_length_t argc)
 {
-    // requires: single argument can be a numeric size in bytes, an array of uint8,
-    //           or a string.
+    // requires: first argument can be a numeric size in bytes, an array of
+    //           uint8, another Buffer to copy, or a string; a string may be
+    //           followed by its encoding, utf8 (default), hex or base64
     //  effects: constructs a new JS Buffer object, and an associated buffer
-    //             tied to it through a zjs_buffer_t struct stored in a global
-    //             list
-    if (argc != 1 ||
+    //             tied to it through a zjs_buffer_t struct stored as its
+    //             native handle
+    zjs_buffer_t *src = argc >= 1 ? zjs_buffer_find(argv[0]) : NULL;
+    if (argc < 1 || argc > 2 ||
         !(jerry_value_is_number(argv[0]) ||
         jerry_value_is_array(argv[0]) ||
-        jerry_value_is_string(argv[0])))
+        jerry_value_is_string(argv[0]) || src))
+        return zjs_error("zjs_buffer: invalid argument");
+
+    if (argc == 2 &&
+        !(jerry_value_is_string(argv[0]) && jerry_value_is_string(argv[1])))
         return zjs_error("zjs_buffer: invalid argument");
 
     if (jerry_value_is_number(argv[0])) {
         // If passed a number, use that to allocate a buffer with a length of that number
         uint32_t size = (uint32_t)jerry_get_number_value(argv[0]);
-        return zjs_buffer_create(size);
+        return zjs_buffer_create(size, NULL);
+    } else if (src) {
+        // If passed a Buffer, copy its contents into a new one
+        zjs_buffer_t *buf;
+        jerry_value_t new_buf_obj = zjs_buffer_create(src->bufsize, &buf);
+        if (buf)
+            memcpy(buf->buffer, src->buffer, src->bufsize);
+        return new_buf_obj;
     } else if (jerry_value_is_array(argv[0])){
         // If passed an array, allocate the memory and fill it with the array value
         jerry_value_t array = argv[0];
         uint32_t arr_size = jerry_get_array_length(array);
-        jerry_value_t new_buf_obj = zjs_buffer_create(arr_size);
-        zjs_buffer_t *buf = zjs_buffer_find(new_buf_obj);
+        zjs_buffer_t *buf;
+        jerry_value_t new_buf_obj = zjs_buffer_create(arr_size, &buf);
         jerry_value_t array_item;
 
         if (buf) {
             if (arr_size > buf->bufsize) {
+                jerry_release_value(new_buf_obj);
                 return zjs_error("zjs_buffer: write beyond end of buffer");
             }
 
             for (int i = 0; i < arr_size; i++) {
                 array_item = jerry_get_property_by_index(array, i);
                 if (jerry_value_is_number(array_item)) {
-                    buf->buffer[i] = (uint8_t)jerry_get_number_value(array_item);
+                    buf->buffer[i] = zjs_buffer_number_byte(
+                        jerry_get_number_value(array_item));
+                    jerry_release_value(array_item);
                 } else {
+                    jerry_release_value(array_item);
+                    jerry_release_value(new_buf_obj);
                     return zjs_error("zjs_buffer: buffer only supports numeric values in an array");
                 }
             }
         }
         return new_buf_obj;
     } else {
-        // If passed a string, convert it into a char array and copy it to the buffer.
+        enum zjs_buffer_encoding encoding = ZJS_ENCODING_UTF8;
+        if (argc == 2) {
+            encoding = zjs_buffer_get_encoding(argv[1]);
+            if (encoding == ZJS_ENCODING_UNKNOWN)
+                return zjs_error("zjs_buffer: unsupported encoding type");
+        }
+
         jerry_value_t arg = argv[0];
         jerry_size_t sz = jerry_get_string_size(arg);
-        jerry_value_t new_buf_obj = zjs_buffer_create(sz);
-        zjs_buffer_t *buf = zjs_buffer_find(new_buf_obj);
 
-        if (buf) {
-            jerry_string_to_char_buffer(arg, (char*)buf->buffer, sz);
-        } else {
-            return zjs_error("zjs_buffer: unable to find string buffer");
+        if (encoding == ZJS_ENCODING_UTF8) {
+            // If passed a string, convert it into a char array and copy it to the buffer.
+            zjs_buffer_t *buf;
+            jerry_value_t new_buf_obj = zjs_buffer_create(sz, &buf);
+
+            if (buf) {
+                jerry_string_to_char_buffer(arg, (char*)buf->buffer, sz);
+            } else {
+                return zjs_error("zjs_buffer: unable to find string buffer");
+            }
+
+            return new_buf_obj;
         }
 
+        // decode in place to find out the size, then copy the result into a
+        //   buffer of exactly that size
+        uint8_t *str = (uint8_t *)scratch_malloc(sz);
+        if (sz && !str)
+            return zjs_error("zjs_buffer: out of memory");
+
+        jerry_string_to_char_buffer(arg, (jerry_char_t *)str, sz);
+        uint32_t size = zjs_buffer_decode(encoding, str, sz, str, sz);
+
+        zjs_buffer_t *buf;
+        jerry_value_t new_buf_obj = zjs_buffer_create(size, &buf);
+        if (buf)
+            memcpy(buf->buffer, str, size);
+        if (str)
+            scratch_free(str);
+
+        if (!buf)
+            return zjs_error("zjs_buffer: unable to find string buffer");
         return new_buf_obj;
     }
 }
 
 void zjs_buffer_init()
 {
+    zjs_native_func_t array[] = {
+        { zjs_buffer_read_array, "readArray" },
+        { zjs_buffer_to_string, "toString" },
+        { zjs_buffer_to_json, "toJSON" },
+        { zjs_buffer_write_string, "write" },
+        { zjs_buffer_slice, "slice" },
+        { zjs_buffer_copy, "copy" },
+        { zjs_buffer_fill, "fill" },
+        { zjs_buffer_equals, "equals" },
+        { zjs_buffer_compare, "compare" },
+        { zjs_buffer_index_of, "indexOf" },
+        { NULL, NULL }
+    };
+    zjs_buffer_prototype = jerry_create_object();
+    zjs_obj_add_functions(zjs_buffer_prototype, array);
+
+    for (const zjs_buffer_accessor_t *acc = zjs_buffer_accessors; acc->name;
+         acc++) {
+        zjs_buffer_add_accessor(zjs_buffer_prototype, "read", zjs_buffer_read,
+                                acc);
+        zjs_buffer_add_accessor(zjs_buffer_prototype, "write",
+                                zjs_buffer_write, acc);
+    }
+
+    jerry_value_t buffer_func = jerry_create_external_function(zjs_buffer);
+    zjs_obj_add_function(buffer_func, zjs_buffer_concat, "concat");
+
     jerry_value_t global_obj = jerry_get_global_object();
-    zjs_obj_add_function(global_obj, zjs_buffer, "Buffer");
+    zjs_set_property(global_obj, "Buffer", buffer_func);
+    jerry_release_value(global_obj);
+    jerry_release_value(buffer_func);
 }
 #endif // BUILD_MODULE_BUFFER
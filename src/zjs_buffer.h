@@ -8,14 +8,21 @@
 void zjs_buffer_init();
 
 typedef struct zjs_buffer {
+    // must come first, zjs_buffer_find uses it to recognize buffers; other
+    //   native handles never point to a private static in zjs_buffer.c
+    const void *tag;
     jerry_value_t obj;
     uint8_t *buffer;
     uint32_t bufsize;
-    struct zjs_buffer *next;
+    // for a slice, the buffer object that owns the memory, otherwise 0
+    jerry_value_t parent;
 } zjs_buffer_t;
 
 zjs_buffer_t *zjs_buffer_find(const jerry_value_t obj);
 
-jerry_value_t zjs_buffer_create(uint32_t size);
+// Creates a new Buffer of size bytes and returns its JS object, or undefined
+//   if out of memory; if ret_buf isn't NULL, *ret_buf gets the new buffer
+//   struct (or NULL) so native code can fill it in directly
+jerry_value_t zjs_buffer_create(uint32_t size, zjs_buffer_t **ret_buf);
 
 #endif  // __zjs_buffer_h__
@@ -2,6 +2,10 @@
 
 #ifndef ZJS_LINUX_BUILD
 #include <zephyr.h>
+#include <atomic.h>
+#include "zjs_zephyr_time.h"
+#else
+#include "zjs_linux_time.h"
 #endif
 #include <string.h>
 
@@ -11,13 +15,60 @@
 #include "jerry-api.h"
 
 #define INITIAL_CALLBACK_SIZE  16
-#define CB_CHUNK_SIZE          16
 
 #define CALLBACK_TYPE_JS    0
 #define CALLBACK_TYPE_C     1
 
 #define CB_LIST_MULTIPLIER  4
 
+// must be a power of two
+#define SIGNAL_QUEUE_SIZE   64
+
+// must be a power of two
+#define ISR_RING_SIZE       32
+
+// keeps the compiler from moving ring stores across the index update; both
+//   targets are single core, so no hardware fence is needed
+#define ZJS_BARRIER()       __asm__ __volatile__("" ::: "memory")
+
+#ifdef ZJS_LINUX_BUILD
+// the Linux build is single threaded, so plain loads and stores will do
+typedef int atomic_t;
+typedef int atomic_val_t;
+
+static inline atomic_val_t atomic_get(const atomic_t *target)
+{
+    return *target;
+}
+
+static inline atomic_val_t atomic_set(atomic_t *target, atomic_val_t value)
+{
+    atomic_val_t old = *target;
+    *target = value;
+    return old;
+}
+
+static inline int atomic_cas(atomic_t *target, atomic_val_t old_value,
+                             atomic_val_t new_value)
+{
+    if (*target != old_value) {
+        return 0;
+    }
+    *target = new_value;
+    return 1;
+}
+
+// nothing else can run while the main loop does, so there is nothing to lock
+static inline unsigned int irq_lock(void)
+{
+    return 0;
+}
+
+static inline void irq_unlock(unsigned int key)
+{
+}
+#endif
+
 struct zjs_callback_t {
     int32_t id;
     void* handle;
@@ -38,91 +89,178 @@ struct zjs_c_callback_t {
 };
 
 struct zjs_callback_map {
+    atomic_t signal;    // set while the ID is waiting in the signal queue
     uint8_t type;
-    uint8_t signal;
+    uint8_t calling;    // nesting depth of calls currently in progress
+    uint8_t removed;    // removed while being called, free after the call
     union {
         struct zjs_callback_t* js;
         struct zjs_c_callback_t* c;
     };
 };
 
-static int32_t cb_limit = INITIAL_CALLBACK_SIZE;
+// Free slots in cb_map hold the index of the next free slot instead of a
+//   pointer, tagged in the low bit, so allocating and releasing an ID is O(1).
+#define FREE_SLOT(next)     ((struct zjs_callback_map*)(((uintptr_t)(next) << 1) | 1))
+#define IS_FREE_SLOT(slot)  ((uintptr_t)(slot) & 1)
+#define NEXT_FREE(slot)     ((int32_t)((intptr_t)(slot) >> 1))
+
+static int32_t cb_limit = 0;
+// one past the highest ID ever handed out
 static int32_t cb_size = 0;
+// first free slot, or -1 if the map is full
+static int32_t cb_free = -1;
 static struct zjs_callback_map** cb_map = NULL;
 
+// IDs of signaled callbacks, in the order the signals arrived; producers
+//   reserve a slot by advancing sig_tail, only the main loop advances sig_head
+static int32_t sig_queue[SIGNAL_QUEUE_SIZE];
+static atomic_t sig_head = 0;
+static atomic_t sig_tail = 0;
+// set when a signal didn't fit, servicing then falls back to a full scan
+static atomic_t sig_overflow = 0;
+
+struct isr_event {
+    int32_t id;
+    uint32_t payload;
+    uint32_t timestamp;
+};
+
+// Single producer, single consumer ring of ISR events. The producer side is
+//   every ISR of one interrupt priority, which can't preempt each other, and
+//   the consumer is the main loop; each side only ever writes its own index.
+struct isr_ring {
+    struct isr_event events[ISR_RING_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflows;    // events dropped because the ring was full
+    uint32_t reported;              // overflows already reported
+};
+
+static struct isr_ring isr_rings[ZJS_PRIO_COUNT];
+// event being delivered by the current call, if any
+static struct isr_event* cur_event = NULL;
+// nesting depth of calls in progress, across all callbacks
+static uint8_t call_depth = 0;
+
+// microtasks waiting to run, in order
+static struct zjs_microtask* microtask_head = NULL;
+static struct zjs_microtask* microtask_tail = NULL;
+static bool running_microtasks = false;
+
+static struct zjs_callback_map* get_cb(int32_t id)
+{
+    // effects: returns the callback registered with id, or NULL if there
+    //            is none
+    if (id < 0 || id >= cb_limit || IS_FREE_SLOT(cb_map[id])) {
+        return NULL;
+    }
+    return cb_map[id];
+}
+
+static bool grow_map(void)
+{
+    // requires: called from the main task
+    //  effects: doubles the size of the callback map, chaining the new slots
+    //             onto the free list; returns false if out of memory
+    int32_t limit = cb_limit ? cb_limit * 2 : INITIAL_CALLBACK_SIZE;
+    size_t size = sizeof(struct zjs_callback_map *) * limit;
+    struct zjs_callback_map** new_map = zjs_malloc(size);
+    if (!new_map) {
+        DBG_PRINT("error allocating space for new callback map\n");
+        return false;
+    }
+    DBG_PRINT("callback list size too small, increasing to %ld\n", limit);
+    if (cb_map) {
+        memcpy(new_map, cb_map, sizeof(struct zjs_callback_map *) * cb_limit);
+    }
+    // push in reverse so the lowest new ID comes off the list first
+    for (int32_t i = limit - 1; i >= cb_limit; i--) {
+        new_map[i] = FREE_SLOT(cb_free);
+        cb_free = i;
+    }
+
+    // zjs_signal_callback reads the map from fibers and ISRs, which can
+    //   preempt the main task but always run to completion before it resumes;
+    //   so once the map and its limit are swapped with interrupts locked, no
+    //   signaler can still be using the old map and it is safe to free
+    struct zjs_callback_map** old_map = cb_map;
+    unsigned int key = irq_lock();
+    cb_map = new_map;
+    cb_limit = limit;
+    irq_unlock(key);
+    if (old_map) {
+        zjs_free(old_map);
+    }
+    return true;
+}
+
 static int32_t new_id(void)
 {
-    int32_t id = 0;
-    if (cb_size >= cb_limit) {
-        cb_limit += CB_CHUNK_SIZE;
-        size_t size = sizeof(struct zjs_callback_map *) * cb_limit;
-        struct zjs_callback_map** new_map = zjs_malloc(size);
-        if (!new_map) {
-            DBG_PRINT("error allocating space for new callback map\n");
-            return -1;
-        }
-        DBG_PRINT("callback list size too small, increasing by %d\n",
-                  CB_CHUNK_SIZE);
-        memset(new_map, 0, size);
-        memcpy(new_map, cb_map, sizeof(struct zjs_callback_map *) * cb_size);
-        zjs_free(cb_map);
-        cb_map = new_map;
+    if (cb_free == -1 && !grow_map()) {
+        return -1;
     }
-    while (cb_map[id] != NULL) {
-        id++;
+    int32_t id = cb_free;
+    cb_free = NEXT_FREE(cb_map[id]);
+    if (id >= cb_size) {
+        cb_size = id + 1;
     }
     return id;
 }
 
+static void free_id(int32_t id)
+{
+    cb_map[id] = FREE_SLOT(cb_free);
+    cb_free = id;
+}
+
 void zjs_init_callbacks(void)
 {
     if (!cb_map) {
-        size_t size = sizeof(struct zjs_callback_map *) *
-            INITIAL_CALLBACK_SIZE;
-        cb_map = (struct zjs_callback_map**)zjs_malloc(size);
-        if (!cb_map) {
+        if (!grow_map()) {
             DBG_PRINT("error allocating space for CB map\n");
-            return;
         }
-        memset(cb_map, 0, size);
     }
     return;
 }
 
 void zjs_edit_js_func(int32_t id, jerry_value_t func)
 {
-    if (id != -1) {
-        jerry_release_value(cb_map[id]->js->js_func);
-        cb_map[id]->js->js_func = jerry_acquire_value(func);
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb && cb->type == CALLBACK_TYPE_JS) {
+        jerry_release_value(cb->js->js_func);
+        cb->js->js_func = jerry_acquire_value(func);
     }
 }
 
 void zjs_edit_callback_handle(int32_t id, void* handle)
 {
-    if (id != -1) {
-        if (cb_map[id]->type == CALLBACK_TYPE_JS) {
-            if (cb_map[id]->js) {
-                cb_map[id]->js->handle = handle;
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb) {
+        if (cb->type == CALLBACK_TYPE_JS) {
+            if (cb->js) {
+                cb->js->handle = handle;
             }
         } else {
-            cb_map[id]->c->handle = handle;
+            cb->c->handle = handle;
         }
     }
 }
 
 bool zjs_remove_callback_list_func(int32_t id, jerry_value_t js_func)
 {
-    if (id != -1 && cb_map[id] && cb_map[id]->js) {
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb && cb->type == CALLBACK_TYPE_JS && cb->js) {
         int i;
-        for (i = 0; i < cb_map[id]->js->num_funcs; ++i) {
-            if (js_func == cb_map[id]->js->func_list[i]) {
+        for (i = 0; i < cb->js->num_funcs; ++i) {
+            if (js_func == cb->js->func_list[i]) {
                 int j;
-                jerry_release_value(cb_map[id]->js->func_list[i]);
-                for (j = i; j < cb_map[id]->js->num_funcs - 1; ++j) {
-                    cb_map[id]->js->func_list[j] = cb_map[id]->js->func_list[j + 1];
+                jerry_release_value(cb->js->func_list[i]);
+                for (j = i; j < cb->js->num_funcs - 1; ++j) {
+                    cb->js->func_list[j] = cb->js->func_list[j + 1];
                 }
-                cb_map[id]->js->num_funcs--;
-                cb_map[id]->js->func_list[cb_map[id]->js->num_funcs] = 0;
+                cb->js->num_funcs--;
+                cb->js->func_list[cb->js->num_funcs] = 0;
                 return true;
             }
         }
@@ -132,25 +270,50 @@ bool zjs_remove_callback_list_func(int32_t id, jerry_value_t js_func)
 
 int zjs_get_num_callbacks(int32_t id)
 {
-    if (id != -1) {
-        if (cb_map[id] && cb_map[id]->js) {
-            return cb_map[id]->js->num_funcs;
-        }
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb && cb->type == CALLBACK_TYPE_JS && cb->js) {
+        return cb->js->num_funcs;
     }
     return 0;
 }
 
 jerry_value_t* zjs_get_callback_func_list(int32_t id, int* count)
 {
-    if (id != -1) {
-        if (cb_map[id] && cb_map[id]->js) {
-            *count = cb_map[id]->js->num_funcs;
-            return cb_map[id]->js->func_list;
-        }
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb && cb->type == CALLBACK_TYPE_JS && cb->js) {
+        *count = cb->js->num_funcs;
+        return cb->js->func_list;
     }
     return NULL;
 }
 
+static struct zjs_callback_map* new_js_callback(void)
+{
+    // effects: allocates a JS callback and its map entry, and gives it an ID
+    struct zjs_callback_map* new_cb = zjs_malloc(sizeof(struct zjs_callback_map));
+    if (!new_cb) {
+        DBG_PRINT("error allocating space for new callback\n");
+        return NULL;
+    }
+    new_cb->js = zjs_malloc(sizeof(struct zjs_callback_t));
+    if (!new_cb->js) {
+        DBG_PRINT("error allocating space for new callback\n");
+        zjs_free(new_cb);
+        return NULL;
+    }
+    new_cb->js->id = new_id();
+    if (new_cb->js->id == -1) {
+        zjs_free(new_cb->js);
+        zjs_free(new_cb);
+        return NULL;
+    }
+    new_cb->type = CALLBACK_TYPE_JS;
+    new_cb->signal = 0;
+    new_cb->calling = 0;
+    new_cb->removed = 0;
+    return new_cb;
+}
+
 int32_t zjs_add_callback_list(jerry_value_t js_func,
                               jerry_value_t this,
                               void* handle,
@@ -159,71 +322,71 @@ int32_t zjs_add_callback_list(jerry_value_t js_func,
                               int32_t id)
 {
     if (id != -1) {
-        if (cb_map[id] && cb_map[id]->js && cb_map[id]->js->func_list) {
+        struct zjs_callback_map* cb = get_cb(id);
+        if (cb && cb->type == CALLBACK_TYPE_JS && cb->js->func_list) {
             // The function list is full, allocate more space, copy the existing
             // list, and add the new function
-            if (cb_map[id]->js->num_funcs == cb_map[id]->js->max_funcs - 1) {
+            if (cb->js->num_funcs == cb->js->max_funcs - 1) {
                 int i;
                 jerry_value_t* new_list = zjs_malloc((sizeof(jerry_value_t) *
-                        (cb_map[id]->js->max_funcs + CB_LIST_MULTIPLIER)));
-                for (i = 0; i < cb_map[id]->js->num_funcs; ++i) {
-                    new_list[i] = cb_map[id]->js->func_list[i];
+                        (cb->js->max_funcs + CB_LIST_MULTIPLIER)));
+                if (!new_list) {
+                    DBG_PRINT("could not allocate function list\n");
+                    return -1;
+                }
+                for (i = 0; i < cb->js->num_funcs; ++i) {
+                    new_list[i] = cb->js->func_list[i];
                 }
-                new_list[cb_map[id]->js->num_funcs] = jerry_acquire_value(js_func);
+                new_list[cb->js->num_funcs] = jerry_acquire_value(js_func);
 
-                cb_map[id]->js->max_funcs += CB_LIST_MULTIPLIER;
-                zjs_free(cb_map[id]->js->func_list);
-                cb_map[id]->js->func_list = new_list;
+                cb->js->max_funcs += CB_LIST_MULTIPLIER;
+                zjs_free(cb->js->func_list);
+                cb->js->func_list = new_list;
             } else {
                 // Add function to list
-                cb_map[id]->js->func_list[cb_map[id]->js->num_funcs] =
+                cb->js->func_list[cb->js->num_funcs] =
                         jerry_acquire_value(js_func);
             }
             // If not already set, set the handle/pre/post provided. These will
             // only be set once, when the list is created.
-            if (!cb_map[id]->js->handle) {
-                cb_map[id]->js->handle = handle;
+            if (!cb->js->handle) {
+                cb->js->handle = handle;
             }
-            if (!cb_map[id]->js->pre) {
-                cb_map[id]->js->pre = pre;
+            if (!cb->js->pre) {
+                cb->js->pre = pre;
             }
-            if (!cb_map[id]->js->post) {
-                cb_map[id]->js->post = post;
+            if (!cb->js->post) {
+                cb->js->post = post;
             }
-            cb_map[id]->js->num_funcs++;
-            return cb_map[id]->js->id;
+            cb->js->num_funcs++;
+            return cb->js->id;
         } else {
             DBG_PRINT("list handle was NULL\n");
             return -1;
         }
     } else {
-        struct zjs_callback_map* new_cb = zjs_malloc(sizeof(struct zjs_callback_map));
+        struct zjs_callback_map* new_cb = new_js_callback();
         if (!new_cb) {
-            DBG_PRINT("error allocating space for new callback\n");
             return -1;
         }
-        new_cb->js = zjs_malloc(sizeof(struct zjs_callback_t));
-        if (!new_cb->js) {
-            DBG_PRINT("error allocating space for new callback\n");
+        new_cb->js->func_list = zjs_malloc(sizeof(jerry_value_t) * CB_LIST_MULTIPLIER);
+        if (!new_cb->js->func_list) {
+            DBG_PRINT("could not allocate function list\n");
+            free_id(new_cb->js->id);
+            zjs_free(new_cb->js);
             zjs_free(new_cb);
             return -1;
         }
-        new_cb->type = CALLBACK_TYPE_JS;
-        new_cb->signal = 0;
-        new_cb->js->id = new_id();
+        new_cb->js->js_func = 0;
+        new_cb->js->this = this;
         new_cb->js->pre = pre;
         new_cb->js->post = post;
         new_cb->js->handle = handle;
+        new_cb->js->once = 0;
         new_cb->js->max_funcs = CB_LIST_MULTIPLIER;
         new_cb->js->num_funcs = 1;
-        new_cb->js->func_list = zjs_malloc(sizeof(jerry_value_t) * CB_LIST_MULTIPLIER);
-        if (!new_cb->js->func_list) {
-            DBG_PRINT("could not allocate function list\n");
-            return -1;
-        }
         new_cb->js->func_list[0] = jerry_acquire_value(js_func);
         cb_map[new_cb->js->id] = new_cb;
-        cb_size++;
         return new_cb->js->id;
     }
 }
@@ -235,20 +398,10 @@ int32_t add_callback(jerry_value_t js_func,
                      zjs_post_callback_func post,
                      uint8_t once)
 {
-    struct zjs_callback_map* new_cb = zjs_malloc(sizeof(struct zjs_callback_map));
+    struct zjs_callback_map* new_cb = new_js_callback();
     if (!new_cb) {
-        DBG_PRINT("error allocating space for new callback\n");
-        return -1;
-    }
-    new_cb->js = zjs_malloc(sizeof(struct zjs_callback_t));
-    if (!new_cb->js) {
-        DBG_PRINT("error allocating space for new callback\n");
-        zjs_free(new_cb);
         return -1;
     }
-    new_cb->type = CALLBACK_TYPE_JS;
-    new_cb->signal = 0;
-    new_cb->js->id = new_id();
     new_cb->js->js_func = jerry_acquire_value(js_func);
     new_cb->js->this = this;
     new_cb->js->pre = pre;
@@ -261,7 +414,6 @@ int32_t add_callback(jerry_value_t js_func,
 
     // Add callback to list
     cb_map[new_cb->js->id] = new_cb;
-    cb_size++;
 
     DBG_PRINT("adding new callback id %ld, js_func=%lu, once=%u\n",
               new_cb->js->id, new_cb->js->js_func, once);
@@ -287,41 +439,120 @@ int32_t zjs_add_callback_once(jerry_value_t js_func,
     return add_callback(js_func, this, handle, pre, post, 1);
 }
 
+static void purge_isr_events(int32_t id)
+{
+    // effects: cancels the queued ISR events for id, so they can't reach a
+    //            later callback that reuses the ID
+    int i;
+    for (i = 0; i < ZJS_PRIO_COUNT; i++) {
+        struct isr_ring* ring = &isr_rings[i];
+        uint32_t tail = ring->tail;
+        uint32_t j;
+        // the slots between head and tail belong to the main loop
+        for (j = ring->head; j != tail; j++) {
+            struct isr_event* ev = &ring->events[j & (ISR_RING_SIZE - 1)];
+            if (ev->id == id) {
+                ev->id = -1;
+            }
+        }
+    }
+}
+
 void zjs_remove_callback(int32_t id)
 {
-    if (id != -1 && cb_map[id]) {
-        if (cb_map[id]->type == CALLBACK_TYPE_JS && cb_map[id]->js) {
-            if (cb_map[id]->js->func_list) {
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb) {
+        if (cb->calling) {
+            // still on the stack in zjs_call_callback, which will finish the
+            //   job when it returns
+            cb->removed = 1;
+            atomic_set(&cb->signal, 0);
+            return;
+        }
+        if (cb->type == CALLBACK_TYPE_JS && cb->js) {
+            if (cb->js->func_list) {
                 int i;
-                for (i = 0; i < cb_map[id]->js->num_funcs; ++i) {
-                    jerry_release_value(cb_map[id]->js->func_list[i]);
+                for (i = 0; i < cb->js->num_funcs; ++i) {
+                    jerry_release_value(cb->js->func_list[i]);
                 }
-                zjs_free(cb_map[id]->js->func_list);
+                zjs_free(cb->js->func_list);
             } else {
-                jerry_release_value(cb_map[id]->js->js_func);
+                jerry_release_value(cb->js->js_func);
             }
-            zjs_free(cb_map[id]->js);
-        } else if (cb_map[id]->c) {
-            zjs_free(cb_map[id]->c);
+            zjs_free(cb->js);
+        } else if (cb->c) {
+            zjs_free(cb->c);
         }
-        zjs_free(cb_map[id]);
-        cb_map[id] = NULL;
+        zjs_free(cb);
+        free_id(id);
+        purge_isr_events(id);
         DBG_PRINT("removing callback id %ld\n", id);
     }
 }
 
 void zjs_signal_callback(int32_t id)
 {
-    if (id != -1 && cb_map[id]) {
+    struct zjs_callback_map* cb = get_cb(id);
+    if (cb && !cb->removed) {
 #ifdef DEBUG_BUILD
-        if (cb_map[id]->type == CALLBACK_TYPE_JS) {
+        if (cb->type == CALLBACK_TYPE_JS) {
             DBG_PRINT("signaling JS callback id %ld\n", id);
         } else {
             DBG_PRINT("signaling C callback id %ld\n", id);
         }
 #endif
-        cb_map[id]->signal = 1;
+        // already queued, the pending call will cover this signal too
+        if (atomic_set(&cb->signal, 1)) {
+            return;
+        }
+        // NOTE: signals come from the main task, fibers and ISRs, all of which
+        //   run to completion before the main loop can consume the slot, so
+        //   the slot is always written by the time it is read
+        while (1) {
+            atomic_val_t tail = atomic_get(&sig_tail);
+            if (tail - atomic_get(&sig_head) >= SIGNAL_QUEUE_SIZE) {
+                atomic_set(&sig_overflow, 1);
+                break;
+            }
+            if (atomic_cas(&sig_tail, tail, tail + 1)) {
+                sig_queue[tail & (SIGNAL_QUEUE_SIZE - 1)] = id;
+                break;
+            }
+        }
+        zjs_loop_unblock();
+    }
+}
+
+void zjs_signal_callback_isr(int32_t id, uint32_t payload, uint8_t prio)
+{
+    struct isr_ring* ring = &isr_rings[prio];
+    uint32_t tail = ring->tail;
+    if (tail - ring->head >= ISR_RING_SIZE) {
+        ring->overflows++;
+    } else {
+        struct isr_event* ev = &ring->events[tail & (ISR_RING_SIZE - 1)];
+        ev->id = id;
+        ev->payload = payload;
+        ev->timestamp = zjs_port_timer_get_uptime();
+        // publish the event only once it is complete
+        ZJS_BARRIER();
+        ring->tail = tail + 1;
+    }
+    zjs_loop_unblock();
+}
+
+bool zjs_get_isr_event(uint32_t* payload, uint32_t* timestamp)
+{
+    if (!cur_event) {
+        return false;
+    }
+    if (payload) {
+        *payload = cur_event->payload;
     }
+    if (timestamp) {
+        *timestamp = cur_event->timestamp;
+    }
+    return true;
 }
 
 int32_t zjs_add_c_callback(void* handle, zjs_c_callback_func callback)
@@ -337,15 +568,21 @@ int32_t zjs_add_c_callback(void* handle, zjs_c_callback_func callback)
         zjs_free(new_cb);
         return -1;
     }
+    new_cb->c->id = new_id();
+    if (new_cb->c->id == -1) {
+        zjs_free(new_cb->c);
+        zjs_free(new_cb);
+        return -1;
+    }
     new_cb->type = CALLBACK_TYPE_C;
     new_cb->signal = 0;
-    new_cb->c->id = new_id();
+    new_cb->calling = 0;
+    new_cb->removed = 0;
     new_cb->c->function = callback;
     new_cb->c->handle = handle;
 
     // Add callback to list
     cb_map[new_cb->c->id] = new_cb;
-    cb_size++;
 
     DBG_PRINT("adding new C callback id %ld\n", new_cb->c->id);
 
@@ -357,19 +594,20 @@ void print_callbacks(void)
 {
     int i;
     for (i = 0; i < cb_size; i++) {
-        if (cb_map[i]) {
-            if (cb_map[i]->type == CALLBACK_TYPE_JS) {
+        struct zjs_callback_map* cb = get_cb(i);
+        if (cb) {
+            if (cb->type == CALLBACK_TYPE_JS) {
                 PRINT("[%u] JS Callback:\n\tType: ", i);
-                if (cb_map[i]->js->func_list == NULL &&
-                    jerry_value_is_function(cb_map[i]->js->js_func)) {
+                if (cb->js->func_list == NULL &&
+                    jerry_value_is_function(cb->js->js_func)) {
                     PRINT("Single Function\n");
-                    PRINT("\tjs_func: %lu\n", cb_map[i]->js->js_func);
-                    PRINT("\tonce: %u\n", cb_map[i]->js->once);
-                    PRINT("\tsignal: %u\n", cb_map[i]->signal);
+                    PRINT("\tjs_func: %lu\n", cb->js->js_func);
+                    PRINT("\tonce: %u\n", cb->js->once);
+                    PRINT("\tsignal: %u\n", atomic_get(&cb->signal));
                 } else {
                     PRINT("List\n");
-                    PRINT("\tmax_funcs: %u\n", cb_map[i]->js->max_funcs);
-                    PRINT("\tmax_funcs: %u\n", cb_map[i]->js->num_funcs);
+                    PRINT("\tmax_funcs: %u\n", cb->js->max_funcs);
+                    PRINT("\tmax_funcs: %u\n", cb->js->num_funcs);
                 }
             }
         } else {
@@ -381,59 +619,169 @@ void print_callbacks(void)
 #define print_callbacks() do {} while (0)
 #endif
 
-void zjs_call_callback(int32_t i)
+static void call_callback(int32_t i, struct isr_event* ev)
 {
-    if (cb_map[i]->type == CALLBACK_TYPE_JS) {
-        if (cb_map[i]->js->func_list == NULL && jerry_value_is_function(cb_map[i]->js->js_func)) {
+    // NOTE: the JS functions called here may add and remove callbacks, which
+    //   can move cb_map, so only hold on to the map entry itself; removing
+    //   this callback is deferred until the call is done
+    struct zjs_callback_map* cb = get_cb(i);
+    if (!cb || cb->removed) {
+        return;
+    }
+    // calls can nest, so restore the outer call's event afterwards
+    struct isr_event* outer_event = cur_event;
+    cur_event = ev;
+    cb->calling++;
+    call_depth++;
+    if (cb->type == CALLBACK_TYPE_JS) {
+        if (cb->js->func_list == NULL && jerry_value_is_function(cb->js->js_func)) {
             uint32_t argc = 0;
             jerry_value_t ret_val;
             jerry_value_t* args = NULL;
 
-            if (cb_map[i]->js->pre) {
-                args = cb_map[i]->js->pre(cb_map[i]->js->handle, &argc);
+            if (cb->js->pre) {
+                args = cb->js->pre(cb->js->handle, &argc);
             }
 
-            DBG_PRINT("calling callback id %ld with %lu args\n", cb_map[i]->js->id, argc);
+            DBG_PRINT("calling callback id %ld with %lu args\n", cb->js->id, argc);
             // TODO: Use 'this' in callback module
-            jerry_call_function(cb_map[i]->js->js_func, cb_map[i]->js->this, args, argc);
-            if (cb_map[i]->js->post) {
-                cb_map[i]->js->post(cb_map[i]->js->handle, &ret_val);
+            ret_val = jerry_call_function(cb->js->js_func, cb->js->this, args, argc);
+            if (cb->js->post) {
+                cb->js->post(cb->js->handle, &ret_val);
             }
-            if (cb_map[i]->js->once) {
-                zjs_remove_callback(i);
+            jerry_release_value(ret_val);
+            if (cb->js->once) {
+                cb->removed = 1;
             }
-        } else {
+        } else if (cb->js->func_list) {
             int j;
             uint32_t argc = 0;
-            jerry_value_t ret_val;
+            jerry_value_t ret_val = 0;
             jerry_value_t* args = NULL;
 
-            if (cb_map[i]->js->pre) {
-                args = cb_map[i]->js->pre(cb_map[i]->js->handle, &argc);
+            if (cb->js->pre) {
+                args = cb->js->pre(cb->js->handle, &argc);
             }
 
-            DBG_PRINT("calling callback list id %ld with %lu args\n", cb_map[i]->js->id, argc);
+            DBG_PRINT("calling callback list id %ld with %lu args\n", cb->js->id, argc);
 
-            for (j = 0; j < cb_map[i]->js->num_funcs; ++j) {
-                jerry_call_function(cb_map[i]->js->func_list[j], cb_map[i]->js->this, args, argc);
+            for (j = 0; j < cb->js->num_funcs; ++j) {
+                jerry_value_t func = cb->js->func_list[j];
+                jerry_release_value(ret_val);
+                ret_val = jerry_call_function(func, cb->js->this, args, argc);
+                if (cb->js->func_list[j] != func) {
+                    // it removed itself or an earlier function, which moved
+                    //   the next one down to j
+                    j--;
+                }
             }
-            if (cb_map[i]->js->post) {
-                cb_map[i]->js->post(cb_map[i]->js->handle, &ret_val);
+            if (cb->js->post) {
+                cb->js->post(cb->js->handle, &ret_val);
             }
+            jerry_release_value(ret_val);
         }
-    } else if (cb_map[i]->type == CALLBACK_TYPE_C && cb_map[i]->c->function) {
-        DBG_PRINT("calling callback id %ld\n", cb_map[i]->c->id);
-        cb_map[i]->c->function(cb_map[i]->c->handle);
+    } else if (cb->type == CALLBACK_TYPE_C && cb->c->function) {
+        DBG_PRINT("calling callback id %ld\n", cb->c->id);
+        cb->c->function(cb->c->handle);
+    }
+    cb->calling--;
+    call_depth--;
+    cur_event = outer_event;
+    if (cb->removed && !cb->calling) {
+        zjs_remove_callback(i);
+    }
+    // the callback is done once it is back at the main loop
+    if (!call_depth) {
+        zjs_run_microtasks();
+    }
+}
+
+void zjs_call_callback(int32_t i)
+{
+    call_callback(i, NULL);
+}
+
+void zjs_queue_microtask(struct zjs_microtask* task)
+{
+    task->next = NULL;
+    if (microtask_tail) {
+        microtask_tail->next = task;
+    } else {
+        microtask_head = task;
+    }
+    microtask_tail = task;
+}
+
+void zjs_run_microtasks(void)
+{
+    // a task can call back into JS that ends up here again, but the outer
+    //   loop already picks up anything queued meanwhile
+    if (running_microtasks) {
+        return;
+    }
+    running_microtasks = true;
+    while (microtask_head) {
+        struct zjs_microtask* task = microtask_head;
+        microtask_head = task->next;
+        if (!microtask_head) {
+            microtask_tail = NULL;
+        }
+        task->run(task);
+    }
+    running_microtasks = false;
+}
+
+static void service_isr_ring(struct isr_ring* ring)
+{
+    // only deliver the events present now, later ones wait for the next pass
+    uint32_t tail = ring->tail;
+    ZJS_BARRIER();
+    while (ring->head != tail) {
+        struct isr_event ev = ring->events[ring->head & (ISR_RING_SIZE - 1)];
+        // hand the slot back before the call so the ISR can reuse it
+        ZJS_BARRIER();
+        ring->head++;
+        // the ID may be stale if the callback was removed after the event
+        call_callback(ev.id, &ev);
+    }
+    uint32_t overflows = ring->overflows;
+    if (overflows != ring->reported) {
+        PRINT("error: %lu interrupt events dropped, ring full\n",
+              (unsigned long)(overflows - ring->reported));
+        ring->reported = overflows;
     }
 }
 
 void zjs_service_callbacks(void)
 {
     int i;
-    for (i = 0; i < cb_size; i++) {
-        if (cb_map[i] && cb_map[i]->signal) {
-            cb_map[i]->signal = 0;
-            zjs_call_callback(i);
+    for (i = 0; i < ZJS_PRIO_COUNT; i++) {
+        service_isr_ring(&isr_rings[i]);
+    }
+
+    // only service the signals present now, callbacks signaled while these
+    //   run wait for the next pass
+    atomic_val_t tail = atomic_get(&sig_tail);
+    if (atomic_set(&sig_overflow, 0)) {
+        // some signals were never queued, so drop the queue and find them
+        //   all by their flags instead
+        atomic_set(&sig_head, tail);
+        for (i = 0; i < cb_size; i++) {
+            struct zjs_callback_map* cb = get_cb(i);
+            if (cb && atomic_set(&cb->signal, 0)) {
+                zjs_call_callback(i);
+            }
+        }
+        return;
+    }
+    while (atomic_get(&sig_head) != tail) {
+        atomic_val_t head = atomic_get(&sig_head);
+        int32_t id = sig_queue[head & (SIGNAL_QUEUE_SIZE - 1)];
+        atomic_set(&sig_head, head + 1);
+        // the ID may be stale if the callback was removed after signaling
+        struct zjs_callback_map* cb = get_cb(id);
+        if (cb && atomic_set(&cb->signal, 0)) {
+            zjs_call_callback(id);
         }
     }
 }
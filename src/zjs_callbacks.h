@@ -5,6 +5,12 @@
 
 #include "jerry-api.h"
 
+// Priority classes for zjs_signal_callback_isr(); each class should only be
+//   fed from ISRs of a single interrupt priority
+#define ZJS_PRIO_HIGH       0
+#define ZJS_PRIO_NORMAL     1
+#define ZJS_PRIO_COUNT      2
+
 /*
  * Function that will be called BEFORE the JS function is called.
  * This should return an array of jerry_value_t's that contain
@@ -28,6 +34,21 @@ typedef jerry_value_t* (*zjs_pre_callback_func)(void* handle, uint32_t* argc);
  */
 typedef void (*zjs_post_callback_func)(void* handle, jerry_value_t* ret_val);
 
+struct zjs_microtask;
+
+/*
+ * Function that runs a queued microtask
+ *
+ * @param task          The task passed to zjs_queue_microtask()
+ */
+typedef void (*zjs_microtask_func)(struct zjs_microtask* task);
+
+struct zjs_microtask {
+    struct zjs_microtask* next;
+    zjs_microtask_func run;
+    // embed this within your own struct to add data fields you need
+};
+
 /*
  * Function definition for a C callback
  *
@@ -154,12 +175,41 @@ void zjs_remove_callback(int32_t id);
  * large recursion loops. Signaling a callback will cause the callback to be
  * called only once, and will NOT remove the callback from the list. You can
  * signal callbacks multiple times, but if the callback has not been serviced
- * between signaling, it will only get called once.
+ * between signaling, it will only get called once. This is safe to call from
+ * an ISR or a fiber, and wakes up the main loop if it is sleeping; the callback
+ * map is only swapped with interrupts locked, so it never goes away under a
+ * signaler.
  *
  * @param id            ID returned from zjs_add_callback
  */
 void zjs_signal_callback(int32_t id);
 
+/*
+ * Queue a call to a callback from an ISR. Unlike zjs_signal_callback(), every
+ * event results in its own call, in the order they arrived, and carries a
+ * payload word and a timestamp that the callback can read back with
+ * zjs_get_isr_event(). Events of the ZJS_PRIO_HIGH class are delivered before
+ * those of ZJS_PRIO_NORMAL. If the ring for the class is full the event is
+ * dropped and counted, and the main loop reports the loss. Only call this from
+ * ISRs of the one interrupt priority that feeds the given class.
+ *
+ * @param id            ID returned from zjs_add_callback
+ * @param payload       Data to pass to the callback
+ * @param prio          ZJS_PRIO_HIGH or ZJS_PRIO_NORMAL
+ */
+void zjs_signal_callback_isr(int32_t id, uint32_t payload, uint8_t prio);
+
+/*
+ * Get the event that caused the current call, when the call was queued by
+ * zjs_signal_callback_isr(). Meant to be used from pre and C callbacks.
+ *
+ * @param payload[out]  Payload passed to zjs_signal_callback_isr(), or NULL
+ * @param timestamp[out] Uptime in ticks when the event was queued, or NULL
+ *
+ * @return              True if the current call is for an ISR event
+ */
+bool zjs_get_isr_event(uint32_t* payload, uint32_t* timestamp);
+
 /*
  * Add/register a C callback
  *
@@ -181,8 +231,25 @@ int32_t zjs_add_c_callback(void* handle, zjs_c_callback_func callback);
 void zjs_call_callback(int32_t i);
 
 /*
- * Service the callback module. Any callback's that have been signaled will
- * be serviced and the signal flag will be unset.
+ * Queue a microtask, such as a promise reaction. Microtasks run in the order
+ * they were queued, as soon as the current callback or script returns to the
+ * main loop, and before any other callback. Call only from task context.
+ *
+ * @param task          Task to run, with its run function set; it belongs to
+ *                        the queue until run is called
+ */
+void zjs_queue_microtask(struct zjs_microtask* task);
+
+/*
+ * Run all queued microtasks, including any they queue themselves. Called
+ * after each callback; call it after running a script as well.
+ */
+void zjs_run_microtasks(void);
+
+/*
+ * Service the callback module. Pending ISR events are delivered first, then
+ * any callback's that have been signaled will be serviced and the signal flag
+ * will be unset.
  */
 void zjs_service_callbacks(void);
 
@@ -1,88 +1,343 @@
+#include <string.h>
+
 #include "zjs_event.h"
 #include "zjs_callbacks.h"
+#include "zjs_names.h"
+#include "zjs_objpool.h"
 
 #define ZJS_MAX_EVENT_NAME_SIZE     24
 #define DEFAULT_MAX_LISTENERS       10
-#define HIDDEN_PROP(n) "\377" n
 
-struct event {
-    int num_events;
-    jerry_value_t map;
-    int max_listeners;
-};
+// must be powers of two
+#define NAME_BUCKETS                16
+#define EVENT_BUCKETS               8
+
+// arguments stored in the trigger itself, more than this are heap allocated
+#define EVENT_INLINE_ARGS           4
+// triggers shared by all emitters, more than this are heap allocated, so
+//   pending emits are only limited by memory
+#define EVENT_TRIGGER_POOL_SIZE     16
 
 struct event_trigger {
+    struct event_trigger* next;
     jerry_value_t* argv;
     uint32_t argc;
     void* handle;
     zjs_post_event post;
+    jerry_value_t args[EVENT_INLINE_ARGS];
 };
 
-struct event_names {
-    jerry_value_t name_array;
-    int idx;
+// Event names are interned into a small ID, shared by all emitters; a name is
+//   freed when the last listener entry using it goes away
+struct event_name {
+    struct event_name* next;
+    uint32_t hash;
+    uint16_t id;
+    uint16_t refs;      // listener entries using the name
+    char str[];
 };
 
-jerry_value_t* pre_event(void* h, uint32_t* args_cnt)
+// Listeners for one event name, and the emits waiting to be delivered to them
+//   in order; this is the handle of the event's callback list
+struct event_listener {
+    struct event_name* name;
+    int32_t callback_id;
+    struct event_trigger* head;
+    struct event_trigger* tail;
+    uint8_t busy;       // nesting depth of calls to the listeners
+    uint8_t removed;    // removed while busy, free after the call
+    struct event_listener* next;
+};
+
+struct event {
+    int num_events;     // listener functions, across all names
+    int num_names;      // names with a listener entry
+    int max_listeners;
+    // listener entries, hashed by name ID
+    struct event_listener* buckets[EVENT_BUCKETS];
+};
+
+static struct event_name* names[NAME_BUCKETS];
+static uint16_t name_count = 0;
+
+// holds the EventEmitter methods, shared by all emitters
+static jerry_value_t zjs_event_emitter_prototype = 0;
+// Object.prototype, where the emitter prototype is spliced into a chain
+static jerry_value_t object_prototype = 0;
+
+ZJS_OBJPOOL(trigger_pool, struct event_trigger, EVENT_TRIGGER_POOL_SIZE)
+
+static struct event_trigger* new_trigger(jerry_value_t argv[], uint32_t argc,
+                                         zjs_post_event post, void* h)
 {
-    struct event_trigger* trigger = (struct event_trigger*)h;
-    if (trigger) {
-        *args_cnt = trigger->argc;
-        return trigger->argv;
+    // effects: takes a trigger from the pool and stores the arguments in it,
+    //            acquiring them; returns NULL if out of memory
+    struct event_trigger* trigger = trigger_pool_alloc();
+    if (!trigger) {
+        DBG_PRINT("could not allocate trigger, out of memory\n");
+        return NULL;
+    }
+    if (argc > EVENT_INLINE_ARGS) {
+        trigger->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
+        if (!trigger->argv) {
+            DBG_PRINT("could not allocate trigger args, out of memory\n");
+            trigger_pool_free(trigger);
+            return NULL;
+        }
+    } else {
+        trigger->argv = trigger->args;
     }
-    return NULL;
+
+    int i;
+    for (i = 0; i < argc; ++i) {
+        trigger->argv[i] = jerry_acquire_value(argv[i]);
+    }
+    trigger->argc = argc;
+    trigger->handle = h;
+    trigger->post = post;
+    trigger->next = NULL;
+    return trigger;
 }
 
-void post_event(void* h, jerry_value_t* ret_val)
+static void free_trigger(struct event_trigger* trigger)
+{
+    // effects: calls the trigger's post function, releases its arguments and
+    //            returns it to the pool
+    int i;
+    if (trigger->post) {
+        trigger->post(trigger->handle);
+    }
+    for (i = 0; i < trigger->argc; ++i) {
+        jerry_release_value(trigger->argv[i]);
+    }
+    if (trigger->argv != trigger->args) {
+        zjs_free(trigger->argv);
+    }
+    trigger_pool_free(trigger);
+}
+
+static struct event_trigger* pop_trigger(struct event_listener* listener)
 {
-    struct event_trigger* trigger = (struct event_trigger*)h;
+    struct event_trigger* trigger = listener->head;
     if (trigger) {
-        if (trigger->post) {
-            trigger->post(trigger->handle);
+        listener->head = trigger->next;
+        if (!listener->head) {
+            listener->tail = NULL;
         }
-        if (trigger->argv) {
-            zjs_free(trigger->argv);
+    }
+    return trigger;
+}
+
+static void release_name(struct event_name* name)
+{
+    // effects: frees name if no listener entry uses it any more
+    if (!name || name->refs) {
+        return;
+    }
+    struct event_name** link = &names[name->hash & (NAME_BUCKETS - 1)];
+    while (*link != name) {
+        link = &(*link)->next;
+    }
+    *link = name->next;
+    zjs_free(name);
+}
+
+static void free_listener(struct event_listener* listener)
+{
+    // effects: drops the listener's pending emits and frees it, or leaves
+    //            that to post_event() if its listeners are being called
+    if (listener->busy) {
+        listener->removed = 1;
+        return;
+    }
+    struct event_trigger* trigger;
+    while ((trigger = pop_trigger(listener))) {
+        free_trigger(trigger);
+    }
+    listener->name->refs--;
+    release_name(listener->name);
+    zjs_free(listener);
+}
+
+static struct event_name* intern_name(const char* str, bool create)
+{
+    // effects: returns the interned name matching str; if there is none,
+    //            adds it when create is set and returns NULL otherwise; a
+    //            new name must be given to a listener entry or released
+    uint32_t hash = zjs_hash_string(str);
+    struct event_name** bucket = &names[hash & (NAME_BUCKETS - 1)];
+    struct event_name* name;
+    for (name = *bucket; name; name = name->next) {
+        if (name->hash == hash && !strcmp(name->str, str)) {
+            return name;
         }
-        zjs_free(trigger);
     }
+    if (!create) {
+        return NULL;
+    }
+
+    size_t len = strlen(str);
+    name = zjs_malloc(sizeof(struct event_name) + len + 1);
+    if (!name) {
+        DBG_PRINT("could not allocate event name, out of memory\n");
+        return NULL;
+    }
+    memcpy(name->str, str, len + 1);
+    name->hash = hash;
+    name->id = name_count++;
+    name->refs = 0;
+    name->next = *bucket;
+    *bucket = name;
+    return name;
 }
 
-void zjs_add_event_listener(jerry_value_t obj, const char* event, jerry_value_t listener)
+static struct event_name* get_name_arg(jerry_value_t str, bool create)
 {
-    struct event* ev;
+    // requires: str is a JS string
+    //  effects: returns the interned name for str, as intern_name(); NULL if
+    //             it is too long to be an event name
+    char buf[ZJS_MAX_EVENT_NAME_SIZE + 1];
+    jerry_size_t sz = jerry_get_string_size(str);
+    if (sz > ZJS_MAX_EVENT_NAME_SIZE) {
+        DBG_PRINT("event name is too long\n");
+        return NULL;
+    }
+    int len = jerry_string_to_char_buffer(str, (jerry_char_t *)buf, sz);
+    if (len != sz) {
+        DBG_PRINT("size mismatch\n");
+        return NULL;
+    }
+    buf[len] = '\0';
+    return intern_name(buf, create);
+}
 
-    jerry_value_t event_emitter = zjs_get_property(obj, HIDDEN_PROP("event"));
+static struct event* get_event(jerry_value_t obj)
+{
+    // effects: returns the native event handle of an event emitter, or NULL
+    struct event* ev = NULL;
+    jerry_value_t event_emitter = jerry_get_property(obj, ZJS_NAME(event));
     if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
         DBG_PRINT("native handle not found\n");
-        return;
+        ev = NULL;
     }
-    if (ev->num_events >= ev->max_listeners) {
-        DBG_PRINT("max listeners reached\n");
-        return;
+    jerry_release_value(event_emitter);
+    return ev;
+}
+
+static struct event_listener* find_listener(struct event* ev,
+                                            struct event_name* name)
+{
+    // effects: returns the listener entry for name, or NULL if it has none
+    if (!name) {
+        return NULL;
     }
+    struct event_listener* listener =
+        ev->buckets[name->id & (EVENT_BUCKETS - 1)];
+    while (listener && listener->name != name) {
+        listener = listener->next;
+    }
+    return listener;
+}
 
-    // Event object to hold callback ID and eventually listener arguments
-    jerry_value_t event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        event_obj = jerry_create_object();
+static void remove_listener_entry(struct event* ev,
+                                  struct event_listener* entry)
+{
+    // effects: removes the listener entry and its callback list, and frees it
+    struct event_listener** link =
+        &ev->buckets[entry->name->id & (EVENT_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+    ev->num_events -= zjs_get_num_callbacks(entry->callback_id);
+    ev->num_names--;
+    zjs_remove_callback(entry->callback_id);
+    free_listener(entry);
+}
+
+jerry_value_t* pre_event(void* h, uint32_t* args_cnt)
+{
+    struct event_listener* listener = (struct event_listener*)h;
+    if (listener) {
+        listener->busy++;
+        if (listener->head) {
+            *args_cnt = listener->head->argc;
+            return listener->head->argv;
+        }
     }
+    return NULL;
+}
 
-    int32_t callback_id = -1;
-    jerry_value_t id_prop = zjs_get_property(event_obj, "callback_id");
-    if (jerry_value_is_number(id_prop)) {
-        // If there already is an event object, get the callback ID
-        zjs_obj_get_int32(event_obj, "callback_id", &callback_id);
+void post_event(void* h, jerry_value_t* ret_val)
+{
+    struct event_listener* listener = (struct event_listener*)h;
+    if (listener) {
+        listener->busy--;
+        struct event_trigger* trigger = pop_trigger(listener);
+        if (trigger) {
+            free_trigger(trigger);
+        }
+        if (listener->removed) {
+            free_listener(listener);
+        } else if (listener->head) {
+            // the signal for the next emit was coalesced with this one
+            zjs_signal_callback(listener->callback_id);
+        }
+    }
+}
+
+static bool add_event_listener(jerry_value_t obj,
+                               struct event_name* name,
+                               jerry_value_t listener)
+{
+    struct event* ev = get_event(obj);
+    if (!ev || !name) {
+        release_name(name);
+        return false;
+    }
+    if (ev->num_events >= ev->max_listeners) {
+        DBG_PRINT("max listeners reached\n");
+        release_name(name);
+        return false;
     }
-    callback_id = zjs_add_callback_list(listener, obj, ev, pre_event, post_event, callback_id);
 
-    // Add callback ID to event object
-    zjs_obj_add_number(event_obj, callback_id, "callback_id");
-    // Add event object to master event listener
-    zjs_set_property(ev->map, event, event_obj);
+    struct event_listener* entry = find_listener(ev, name);
+    if (!entry) {
+        entry = zjs_malloc(sizeof(struct event_listener));
+        if (!entry) {
+            DBG_PRINT("could not allocate listener, out of memory\n");
+            release_name(name);
+            return false;
+        }
+        memset(entry, 0, sizeof(struct event_listener));
+        entry->name = name;
+        entry->callback_id = zjs_add_callback_list(listener, obj, entry,
+                                                   pre_event, post_event, -1);
+        if (entry->callback_id == -1) {
+            zjs_free(entry);
+            release_name(name);
+            return false;
+        }
+        name->refs++;
+        struct event_listener** bucket =
+            &ev->buckets[name->id & (EVENT_BUCKETS - 1)];
+        entry->next = *bucket;
+        *bucket = entry;
+        ev->num_names++;
+    } else if (zjs_add_callback_list(listener, obj, NULL, NULL, NULL,
+                                     entry->callback_id) == -1) {
+        return false;
+    }
 
-    DBG_PRINT("added listener, callback id = %ld\n", callback_id);
+    DBG_PRINT("added listener, callback id = %ld\n", entry->callback_id);
 
     ev->num_events++;
+    return true;
+}
+
+void zjs_add_event_listener(jerry_value_t obj, const char* event, jerry_value_t listener)
+{
+    add_event_listener(obj, intern_name(event, true), listener);
 }
 
 static jerry_value_t add_listener(const jerry_value_t function_obj,
@@ -98,22 +353,51 @@ static jerry_value_t add_listener(const jerry_value_t function_obj,
         DBG_PRINT("second parameter must be a listener function\n");
         return ZJS_UNDEFINED;
     }
-    int sz = jerry_get_string_size(argv[0]);
-    if (sz > ZJS_MAX_EVENT_NAME_SIZE) {
-        DBG_PRINT("event name is too long\n");
-        return ZJS_UNDEFINED;
+
+    add_event_listener(this, get_name_arg(argv[0], true), argv[1]);
+
+    return ZJS_UNDEFINED;
+}
+
+static bool trigger_event(jerry_value_t obj,
+                          struct event_name* name,
+                          jerry_value_t argv[],
+                          uint32_t argc,
+                          zjs_post_event post,
+                          void* h)
+{
+    struct event* ev = get_event(obj);
+    if (!ev) {
+        return false;
     }
-    char name[sz];
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)name, sz);
-    if (len != sz) {
-        DBG_PRINT("size mismatch\n");
-        return ZJS_UNDEFINED;
+
+    struct event_listener* listener = find_listener(ev, name);
+    if (!listener) {
+        DBG_PRINT("[event] trigger_event(): no listeners\n");
+        return false;
     }
-    name[len] = '\0';
 
-    zjs_add_event_listener(this, name, argv[1]);
+    struct event_trigger* trigger = new_trigger(argv, argc, post, h);
+    if (!trigger) {
+        // the caller learns of it from the return value, emit() included
+        PRINT("[event] out of memory, dropped emit of '%s'\n", name->str);
+        return false;
+    }
 
-    return ZJS_UNDEFINED;
+    // emits are delivered in order, one per pass of the main loop
+    if (listener->tail) {
+        listener->tail->next = trigger;
+    } else {
+        listener->head = trigger;
+    }
+    listener->tail = trigger;
+
+    zjs_signal_callback(listener->callback_id);
+
+    DBG_PRINT("triggering event '%s', args_cnt=%lu, callback_id=%ld\n",
+              name->str, argc, listener->callback_id);
+
+    return true;
 }
 
 static jerry_value_t emit_event(const jerry_value_t function_obj,
@@ -125,21 +409,14 @@ static jerry_value_t emit_event(const jerry_value_t function_obj,
         DBG_PRINT("parameter is not a string\n");
         return ZJS_UNDEFINED;
     }
-    int sz = jerry_get_string_size(argv[0]);
-    char event[sz];
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)event, sz);
-    if (len != sz) {
-        DBG_PRINT("size mismatch\n");
-        return ZJS_UNDEFINED;
-    }
-    event[len] = '\0';
 
-    return jerry_create_boolean(zjs_trigger_event(this,
-                                                  event,
-                                                  (jerry_value_t*)argv + 1,
-                                                  argc - 1,
-                                                  NULL,
-                                                  NULL));
+    // a name that was never interned can't have listeners
+    return jerry_create_boolean(trigger_event(this,
+                                              get_name_arg(argv[0], false),
+                                              (jerry_value_t*)argv + 1,
+                                              argc - 1,
+                                              NULL,
+                                              NULL));
 }
 
 static jerry_value_t remove_listener(const jerry_value_t function_obj,
@@ -147,11 +424,8 @@ static jerry_value_t remove_listener(const jerry_value_t function_obj,
                                      const jerry_value_t argv[],
                                      const jerry_length_t argc)
 {
-    struct event* ev;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return ZJS_UNDEFINED;
     }
     if (!jerry_value_is_string(argv[0])) {
@@ -162,34 +436,24 @@ static jerry_value_t remove_listener(const jerry_value_t function_obj,
         DBG_PRINT("event listener must be second parameter\n");
         return ZJS_UNDEFINED;
     }
-    int sz = jerry_get_string_size(argv[0]);
-    char event[sz];
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)event, sz);
-    if (len != sz) {
-        DBG_PRINT("size mismatch\n");
-        return ZJS_UNDEFINED;
-    }
-    event[len] = '\0';
 
-    // Event object to hold callback ID and eventually listener arguments
-    jerry_value_t event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        DBG_PRINT("event object not found for '%s'\n", event);
+    struct event_listener* listener =
+        find_listener(ev, get_name_arg(argv[0], false));
+    if (!listener) {
+        DBG_PRINT("no listeners found\n");
         return ZJS_UNDEFINED;
     }
 
-    int32_t callback_id = -1;
-    jerry_value_t id_prop = zjs_get_property(event_obj, "callback_id");
-    if (jerry_value_is_number(id_prop)) {
-        // If there already is an event object, get the callback ID
-        zjs_obj_get_int32(event_obj, "callback_id", &callback_id);
-    } else {
-        DBG_PRINT("callback_id not found for '%s'\n", event);
-        return ZJS_UNDEFINED;
+    bool removed = zjs_remove_callback_list_func(listener->callback_id,
+                                                 argv[1]);
+    if (removed) {
+        ev->num_events--;
+        if (!zjs_get_num_callbacks(listener->callback_id)) {
+            // no listeners left for the name, so drop it from eventNames()
+            remove_listener_entry(ev, listener);
+        }
     }
 
-    bool removed = zjs_remove_callback_list_func(callback_id, argv[1]);
-
     return jerry_create_boolean(removed);
 }
 
@@ -198,83 +462,51 @@ static jerry_value_t remove_all_listeners(const jerry_value_t function_obj,
                                           const jerry_value_t argv[],
                                           const jerry_length_t argc)
 {
-    struct event* ev;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return ZJS_UNDEFINED;
     }
     if (!jerry_value_is_string(argv[0])) {
         DBG_PRINT("event name must be first parameter\n");
         return ZJS_UNDEFINED;
     }
-    int sz = jerry_get_string_size(argv[0]);
-    char event[sz];
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)event, sz);
-    if (len != sz) {
-        DBG_PRINT("size mismatch\n");
-        return ZJS_UNDEFINED;
-    }
-    event[len] = '\0';
-
-    // Event object to hold callback ID and eventually listener arguments
-    jerry_value_t event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        DBG_PRINT("event object not found for '%s'\n", event);
-        return ZJS_UNDEFINED;
-    }
 
-    int32_t callback_id = -1;
-    jerry_value_t id_prop = zjs_get_property(event_obj, "callback_id");
-    if (jerry_value_is_number(id_prop)) {
-        // If there already is an event object, get the callback ID
-        zjs_obj_get_int32(event_obj, "callback_id", &callback_id);
-    } else {
-        DBG_PRINT("callback_id not found for '%s'\n", event);
+    struct event_listener* listener =
+        find_listener(ev, get_name_arg(argv[0], false));
+    if (!listener) {
+        DBG_PRINT("no listeners found\n");
         return ZJS_UNDEFINED;
     }
 
-    zjs_remove_callback(callback_id);
-
-    jerry_value_t event_name_val = jerry_create_string((const jerry_char_t*)event);
-    jerry_delete_property(ev->map, (const jerry_value_t)event_name_val);
-    jerry_release_value(event_name_val);
+    remove_listener_entry(ev, listener);
 
     return ZJS_UNDEFINED;
 }
 
-bool foreach_event_name(const jerry_value_t prop_name,
-                        const jerry_value_t prop_value,
-                        void *data)
-{
-    struct event_names* names = (struct event_names*)data;
-
-    jerry_set_property_by_index(names->name_array,
-                                names->idx++,
-                                prop_name);
-    return true;
-}
-
 static jerry_value_t get_event_names(const jerry_value_t function_obj,
                                      const jerry_value_t this,
                                      const jerry_value_t argv[],
                                      const jerry_length_t argc)
 {
-    struct event* ev;
-    struct event_names names;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return ZJS_UNDEFINED;
     }
-    names.idx = 0;
-    names.name_array = jerry_create_array(ev->num_events);
 
-    jerry_foreach_object_property(ev->map, foreach_event_name, &names);
+    jerry_value_t name_array = jerry_create_array(ev->num_names);
+    int idx = 0;
+    int i;
+    for (i = 0; i < EVENT_BUCKETS; i++) {
+        struct event_listener* listener;
+        for (listener = ev->buckets[i]; listener; listener = listener->next) {
+            jerry_value_t name = jerry_create_string(
+                (const jerry_char_t *)listener->name->str);
+            jerry_set_property_by_index(name_array, idx++, name);
+            jerry_release_value(name);
+        }
+    }
 
-    return names.name_array;
+    return name_array;
 }
 
 static jerry_value_t get_max_listeners(const jerry_value_t function_obj,
@@ -282,11 +514,8 @@ static jerry_value_t get_max_listeners(const jerry_value_t function_obj,
                                        const jerry_value_t argv[],
                                        const jerry_length_t argc)
 {
-    struct event* ev;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return ZJS_UNDEFINED;
     }
     return jerry_create_number(ev->max_listeners);
@@ -297,11 +526,8 @@ static jerry_value_t set_max_listeners(const jerry_value_t function_obj,
                                        const jerry_value_t argv[],
                                        const jerry_length_t argc)
 {
-    struct event* ev;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return ZJS_UNDEFINED;
     }
     if (!jerry_value_is_number(argv[0])) {
@@ -313,61 +539,27 @@ static jerry_value_t set_max_listeners(const jerry_value_t function_obj,
     return ZJS_UNDEFINED;
 }
 
-bool foreach_listener(const jerry_value_t prop_name,
-                      const jerry_value_t prop_value,
-                      void *data)
-{
-    struct event_names* names = (struct event_names*)data;
-
-    jerry_set_property_by_index(names->name_array,
-                                names->idx++,
-                                prop_name);
-    return true;
-}
-
 static jerry_value_t get_listener_count(const jerry_value_t function_obj,
                                         const jerry_value_t this,
                                         const jerry_value_t argv[],
                                         const jerry_length_t argc)
 {
-    struct event* ev;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return zjs_error("native handle not found");
     }
     if (!jerry_value_is_string(argv[0])) {
         DBG_PRINT("event name must be first parameter\n");
         return zjs_error("event name must be first parameter");
     }
-    int sz = jerry_get_string_size(argv[0]);
-    char event[sz];
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)event, sz);
-    if (len != sz) {
-        DBG_PRINT("size mismatch\n");
-        return zjs_error("string size mismatch");
-    }
-    event[len] = '\0';
-
-    // Event object to hold callback ID and eventually listener arguments
-    jerry_value_t event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        DBG_PRINT("event object not found for '%s'\n", event);
-        return jerry_create_number(0);
-    }
 
-    int32_t callback_id = -1;
-    jerry_value_t id_prop = zjs_get_property(event_obj, "callback_id");
-    if (jerry_value_is_number(id_prop)) {
-        // If there already is an event object, get the callback ID
-        zjs_obj_get_int32(event_obj, "callback_id", &callback_id);
-    } else {
-        DBG_PRINT("callback_id not found for '%s'\n", event);
+    struct event_listener* listener =
+        find_listener(ev, get_name_arg(argv[0], false));
+    if (!listener) {
         return jerry_create_number(0);
     }
 
-    return jerry_create_number(zjs_get_num_callbacks(callback_id));
+    return jerry_create_number(zjs_get_num_callbacks(listener->callback_id));
 }
 
 static jerry_value_t get_listeners(const jerry_value_t function_obj,
@@ -375,45 +567,26 @@ static jerry_value_t get_listeners(const jerry_value_t function_obj,
                                    const jerry_value_t argv[],
                                    const jerry_length_t argc)
 {
-    struct event* ev;
-
-    jerry_value_t event_emitter = zjs_get_property(this, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        DBG_PRINT("native handle not found\n");
+    struct event* ev = get_event(this);
+    if (!ev) {
         return ZJS_UNDEFINED;
     }
     if (!jerry_value_is_string(argv[0])) {
         DBG_PRINT("event name must be first parameter\n");
         return ZJS_UNDEFINED;
     }
-    int sz = jerry_get_string_size(argv[0]);
-    char event[sz];
-    int len = jerry_string_to_char_buffer(argv[0], (jerry_char_t *)event, sz);
-    if (len != sz) {
-        DBG_PRINT("size mismatch\n");
-        return ZJS_UNDEFINED;
-    }
-    event[len] = '\0';
 
-    // Event object to hold callback ID and eventually listener arguments
-    jerry_value_t event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        DBG_PRINT("event object not found for '%s'\n", event);
+    struct event_listener* listener =
+        find_listener(ev, get_name_arg(argv[0], false));
+    if (!listener) {
+        DBG_PRINT("no listeners found\n");
         return ZJS_UNDEFINED;
     }
 
-    int32_t callback_id = -1;
-    jerry_value_t id_prop = zjs_get_property(event_obj, "callback_id");
-    if (jerry_value_is_number(id_prop)) {
-        // If there already is an event object, get the callback ID
-        zjs_obj_get_int32(event_obj, "callback_id", &callback_id);
-    } else {
-        DBG_PRINT("callback_id not found for '%s'\n", event);
-        return ZJS_UNDEFINED;
-    }
     int count;
     int i;
-    jerry_value_t* func_array = zjs_get_callback_func_list(callback_id, &count);
+    jerry_value_t* func_array = zjs_get_callback_func_list(listener->callback_id,
+                                                           &count);
     jerry_value_t ret_array = jerry_create_array(count);
     for (i = 0; i < count; ++i) {
         jerry_set_property_by_index(ret_array, i, func_array[i]);
@@ -428,59 +601,7 @@ bool zjs_trigger_event(jerry_value_t obj,
                        zjs_post_event post,
                        void* h)
 {
-    struct event* ev;
-    struct event_trigger* trigger = zjs_malloc(sizeof(struct event_trigger));
-    if (!trigger) {
-        DBG_PRINT("could not allocate trigger, out of memory\n");
-        return false;
-    }
-
-    int32_t callback_id = -1;
-    jerry_value_t event_obj;
-
-    jerry_value_t event_emitter = zjs_get_property(obj, HIDDEN_PROP("event"));
-    if (!jerry_get_object_native_handle(event_emitter, (uintptr_t*)&ev)) {
-        zjs_free(trigger);
-        DBG_PRINT("native handle not found\n");
-        return jerry_create_boolean(false);
-    }
-
-    int i;
-    trigger->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
-    if (!trigger->argv) {
-        zjs_free(trigger);
-        DBG_PRINT("could not allocate trigger args, out of memory\n");
-        return false;
-    }
-    for (i = 0; i < argc; ++i) {
-        trigger->argv[i] = argv[i];
-    }
-    trigger->argc = argc;
-
-    event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        zjs_free(trigger);
-        DBG_PRINT("event object not found\n");
-        return false;
-    }
-
-    if (!zjs_obj_get_int32(event_obj, "callback_id", &callback_id)) {
-        zjs_free(trigger);
-        DBG_PRINT("[event] zjs_trigger_event(): Error, callback_id not found\n");
-        return false;
-    }
-
-    trigger->handle = h;
-    trigger->post = post;
-
-    zjs_edit_callback_handle(callback_id, trigger);
-
-    zjs_signal_callback(callback_id);
-
-    DBG_PRINT("triggering event '%s', args_cnt=%lu, callback_id=%ld\n",
-              event, trigger->argc, callback_id);
-
-    return jerry_create_boolean(true);
+    return trigger_event(obj, intern_name(event, false), argv, argc, post, h);
 }
 
 bool zjs_trigger_event_now(jerry_value_t obj,
@@ -490,94 +611,113 @@ bool zjs_trigger_event_now(jerry_value_t obj,
                            zjs_post_event post,
                            void* h)
 {
-    struct event* ev;
-    struct event_trigger* trigger = zjs_malloc(sizeof(struct event_trigger));
-    if (!trigger) {
-        DBG_PRINT("could not allocate trigger, out of memory\n");
+    struct event* ev = get_event(obj);
+    if (!ev) {
         return false;
     }
 
-    int32_t callback_id = -1;
-    jerry_value_t event_obj;
-
-    if (!jerry_get_object_native_handle(obj, (uintptr_t*)&ev)) {
-        zjs_free(trigger);
-        DBG_PRINT("native handle not found\n");
-        return jerry_create_boolean(false);
-    }
-
-    int i;
-    trigger->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
-    if (!trigger->argv) {
-        zjs_free(trigger);
-        DBG_PRINT("could not allocate trigger args, out of memory\n");
+    struct event_listener* listener =
+        find_listener(ev, intern_name(event, false));
+    if (!listener) {
+        DBG_PRINT("no listeners found\n");
         return false;
     }
-    for (i = 0; i < argc; ++i) {
-        trigger->argv[i] = argv[i];
-    }
-    trigger->argc = argc;
 
-    event_obj = zjs_get_property(ev->map, event);
-    if (!jerry_value_is_object(event_obj)) {
-        zjs_free(trigger);
-        DBG_PRINT("event object not found\n");
+    struct event_trigger* trigger = new_trigger(argv, argc, post, h);
+    if (!trigger) {
         return false;
     }
 
-    zjs_obj_get_uint32(event_obj, "callback_id", &callback_id);
-    if (callback_id == -1) {
-        zjs_free(trigger);
-        DBG_PRINT("callback_id not found\n");
-        return false;
+    // jump the queue, post_event() pops it again after the call
+    trigger->next = listener->head;
+    listener->head = trigger;
+    if (!listener->tail) {
+        listener->tail = trigger;
     }
 
-    trigger->handle = h;
-    trigger->post = post;
-
-    zjs_edit_callback_handle(callback_id, trigger);
+    zjs_call_callback(listener->callback_id);
 
-    zjs_call_callback(callback_id);
-
-    return jerry_create_boolean(true);
+    return true;
 }
 
 static void destroy_event(const uintptr_t pointer)
 {
     struct event* ev = (struct event*)pointer;
     if (ev) {
-        jerry_release_value(ev->map);
+        int i;
+        for (i = 0; i < EVENT_BUCKETS; i++) {
+            while (ev->buckets[i]) {
+                remove_listener_entry(ev, ev->buckets[i]);
+            }
+        }
         zjs_free(ev);
     }
 }
 
+static void inherit_emitter(jerry_value_t obj)
+{
+    // effects: puts the emitter prototype into obj's prototype chain right
+    //            above Object.prototype, so any prototype obj already has is
+    //            kept and inherits the emitter methods in turn
+    jerry_value_t target = jerry_acquire_value(obj);
+    while (1) {
+        jerry_value_t proto = jerry_get_prototype(target);
+        if (proto == zjs_event_emitter_prototype) {
+            // already an emitter
+            jerry_release_value(proto);
+            break;
+        }
+        if (!jerry_value_is_object(proto) || proto == object_prototype) {
+            jerry_release_value(proto);
+            jerry_release_value(jerry_set_prototype(target,
+                                                    zjs_event_emitter_prototype));
+            break;
+        }
+        jerry_release_value(target);
+        target = proto;
+    }
+    jerry_release_value(target);
+}
+
 void zjs_make_event(jerry_value_t obj)
 {
+    if (!zjs_event_emitter_prototype) {
+        // first emitter, set up the shared state
+        zjs_native_func_t array[] = {
+            { add_listener, "on" },
+            { add_listener, "addListener" },
+            { emit_event, "emit" },
+            { remove_listener, "removeListener" },
+            { remove_all_listeners, "removeAllListeners" },
+            { get_event_names, "eventNames" },
+            { get_max_listeners, "getMaxListeners" },
+            { get_listener_count, "listenerCount" },
+            { get_listeners, "listeners" },
+            { set_max_listeners, "setMaxListeners" },
+            { NULL, NULL }
+        };
+        zjs_event_emitter_prototype = jerry_create_object();
+        zjs_obj_add_functions(zjs_event_emitter_prototype, array);
+        object_prototype = jerry_get_prototype(zjs_event_emitter_prototype);
+    }
+
     jerry_value_t event_obj = jerry_create_object();
     struct event* ev = zjs_malloc(sizeof(struct event));
     if (!ev) {
         DBG_PRINT("could not allocate event handle, out of memory\n");
+        jerry_release_value(event_obj);
         return;
     }
 
+    memset(ev, 0, sizeof(struct event));
     ev->max_listeners = DEFAULT_MAX_LISTENERS;
-    ev->num_events = 0;
-    ev->map = jerry_create_object();
-
-    zjs_obj_add_function(obj, add_listener, "on");
-    zjs_obj_add_function(obj, add_listener, "addListener");
-    zjs_obj_add_function(obj, emit_event, "emit");
-    zjs_obj_add_function(obj, remove_listener, "removeListener");
-    zjs_obj_add_function(obj, remove_all_listeners, "removeAllListeners");
-    zjs_obj_add_function(obj, get_event_names, "eventNames");
-    zjs_obj_add_function(obj, get_max_listeners, "getMaxListeners");
-    zjs_obj_add_function(obj, get_listener_count, "listenerCount");
-    zjs_obj_add_function(obj, get_listeners, "listeners");
-    zjs_obj_add_function(obj, set_max_listeners, "setMaxListeners");
+
+    inherit_emitter(obj);
 
     jerry_set_object_native_handle(event_obj, (uintptr_t)ev, destroy_event);
 
-    zjs_obj_add_object(obj, event_obj, HIDDEN_PROP("event"));
+    jerry_set_property(obj, ZJS_NAME(event), event_obj);
+    jerry_release_value(event_obj);
 }
 
 static jerry_value_t event_constructor(const jerry_value_t function_obj,
@@ -13,7 +13,8 @@ typedef void (*zjs_post_event)(void* handle);
 /*
  * Turn an object into an event object. After this call the object will have
  * all the event functions like addListener(), on(), etc. This object can also
- * be used to trigger events in C.
+ * be used to trigger events in C. The event functions come from a shared
+ * prototype, put in the object's chain above any prototype it already has.
  *
  * @param obj           Object to turn into an event object
  */
@@ -38,7 +39,9 @@ void zjs_add_event_listener(jerry_value_t obj, const char* event, jerry_value_t
  * @param post          Function to be called after the event is triggered
  * @param handle        A handle that is accessable in the 'post' call
  *
- * @return              True if there were listeners
+ * @return              True if there were listeners and the emit was queued
+ *                      for them; false if there were none, or if it was
+ *                      dropped because there was no memory to queue it
  */
 bool zjs_trigger_event(jerry_value_t obj,
                        const char* event,
@@ -10,6 +10,7 @@
 #include "zjs_gpio.h"
 #include "zjs_util.h"
 #include "zjs_callbacks.h"
+#include "zjs_names.h"
 #include "zjs_promise.h"
 
 static const char *ZJS_DIR_IN = "in";
@@ -32,6 +33,9 @@ static const char *ZJS_PULL_DOWN = "down";
 
 static struct device *zjs_gpio_dev[GPIO_DEV_COUNT];
 
+// holds the GPIOPin methods, shared by all pin objects
+static jerry_value_t zjs_gpio_pin_prototype = 0;
+
 void (*zjs_gpio_convert_pin)(uint32_t orig, int *dev, int *pin) =
     zjs_default_convert_pin;
 
@@ -50,13 +54,21 @@ struct gpio_handle {
 static void gpio_c_callback(void* h)
 {
     struct gpio_handle *handle = (struct gpio_handle*)h;
-    jerry_value_t onchange_func = zjs_get_property(handle->pin_obj, "onchange");
+    jerry_value_t onchange_func = jerry_get_property(handle->pin_obj,
+                                                     ZJS_NAME(onchange));
+
+    // Use the value read in the ISR for this edge, later edges may already
+    // have overwritten handle->value
+    uint32_t value = handle->value;
+    zjs_get_isr_event(&value, NULL);
 
     // If pin.onChange exists, call it
     if (jerry_value_is_function(onchange_func)) {
         jerry_value_t event = jerry_create_object();
         // Put the boolean GPIO trigger value in the object
-        zjs_obj_add_boolean(event, handle->value, "value");
+        jerry_value_t jvalue = jerry_create_boolean(value);
+        jerry_set_property(event, ZJS_NAME(value), jvalue);
+        jerry_release_value(jvalue);
 
         // Only aquire once, once we have it just keep using it.
         // It will be released in close()
@@ -84,8 +96,8 @@ static void gpio_zephyr_callback(struct device *port,
     struct gpio_handle *handle = CONTAINER_OF(cb, struct gpio_handle, callback);
     // Read the value and save it in the handle
     gpio_pin_read(port, handle->pin, &handle->value);
-    // Signal the C callback, where we call the JS callback
-    zjs_signal_callback(handle->callbackId);
+    // Queue the edge for the C callback, where we call the JS callback
+    zjs_signal_callback_isr(handle->callbackId, handle->value, ZJS_PRIO_HIGH);
 }
 
 static struct gpio_handle* new_gpio_handle(void)
@@ -96,6 +108,21 @@ static struct gpio_handle* new_gpio_handle(void)
     return handle;
 }
 
+static void get_pin_props(jerry_value_t pin_obj, uint32_t *pin,
+                          bool *activeLow)
+{
+    // requires: pin_obj is a GPIOPin object from zjs_gpio_open
+    //  effects: reads its pin number and activeLow flag
+    jerry_value_t value = jerry_get_property(pin_obj, ZJS_NAME(pin));
+    *pin = (uint32_t)jerry_get_number_value(value);
+    jerry_release_value(value);
+
+    value = jerry_get_property(pin_obj, ZJS_NAME(activeLow));
+    *activeLow = jerry_value_is_boolean(value) &&
+                 jerry_get_boolean_value(value);
+    jerry_release_value(value);
+}
+
 static jerry_value_t zjs_gpio_pin_read(const jerry_value_t function_obj,
                                        const jerry_value_t this,
                                        const jerry_value_t argv[],
@@ -104,13 +131,11 @@ static jerry_value_t zjs_gpio_pin_read(const jerry_value_t function_obj,
     // requires: this is a GPIOPin object from zjs_gpio_open, takes no args
     //  effects: reads a logical value from the pin and returns it in ret_val_p
     uint32_t pin;
-    zjs_obj_get_uint32(this, "pin", &pin);
+    bool activeLow;
+    get_pin_props(this, &pin, &activeLow);
     int devnum, newpin;
     zjs_gpio_convert_pin(pin, &devnum, &newpin);
 
-    bool activeLow = false;
-    zjs_obj_get_boolean(this, "activeLow", &activeLow);
-
     uint32_t value;
     int rval = gpio_pin_read(zjs_gpio_dev[devnum], newpin, &value);
     if (rval) {
@@ -139,13 +164,11 @@ static jerry_value_t zjs_gpio_pin_write(const jerry_value_t function_obj,
     bool logical = jerry_get_boolean_value(argv[0]);
 
     uint32_t pin;
-    zjs_obj_get_uint32(this, "pin", &pin);
+    bool activeLow;
+    get_pin_props(this, &pin, &activeLow);
     int devnum, newpin;
     zjs_gpio_convert_pin(pin, &devnum, &newpin);
 
-    bool activeLow = false;
-    zjs_obj_get_boolean(this, "activeLow", &activeLow);
-
     uint32_t value = 0;
     if ((logical && !activeLow) || (!logical && activeLow))
         value = 1;
@@ -286,9 +309,7 @@ static jerry_value_t zjs_gpio_open(const jerry_value_t function_obj,
 
     // create the GPIOPin object
     jerry_value_t pinobj = jerry_create_object();
-    zjs_obj_add_function(pinobj, zjs_gpio_pin_read, "read");
-    zjs_obj_add_function(pinobj, zjs_gpio_pin_write, "write");
-    zjs_obj_add_function(pinobj, zjs_gpio_pin_close, "close");
+    jerry_release_value(jerry_set_prototype(pinobj, zjs_gpio_pin_prototype));
     zjs_obj_add_number(pinobj, pin, "pin");
     zjs_obj_add_string(pinobj, dirOut ? ZJS_DIR_OUT : ZJS_DIR_IN, "direction");
     zjs_obj_add_boolean(pinobj, activeLow, "activeLow");
@@ -371,6 +392,17 @@ jerry_value_t zjs_gpio_init()
         }
     }
 
+    if (!zjs_gpio_pin_prototype) {
+        zjs_native_func_t array[] = {
+            { zjs_gpio_pin_read, "read" },
+            { zjs_gpio_pin_write, "write" },
+            { zjs_gpio_pin_close, "close" },
+            { NULL, NULL }
+        };
+        zjs_gpio_pin_prototype = jerry_create_object();
+        zjs_obj_add_functions(zjs_gpio_pin_prototype, array);
+    }
+
     // create GPIO object
     jerry_value_t gpio_obj = jerry_create_object();
     zjs_obj_add_function(gpio_obj, zjs_gpio_open_sync, "open");
@@ -13,16 +13,21 @@
 // ZJS includes
 #include "zjs_grove_lcd.h"
 #include "zjs_ipm.h"
+#include "zjs_objpool.h"
 #include "zjs_util.h"
 
 #define ZJS_GLCD_TIMEOUT_TICKS                      500
 
+// IPM messages kept for reuse, more than this are heap allocated
+#define GLCD_MSG_POOL_SIZE                          2
+
 static struct nano_sem glcd_sem;
 
+ZJS_OBJPOOL(glcd_msg_pool, zjs_ipm_message_t, GLCD_MSG_POOL_SIZE)
 
 static zjs_ipm_message_t* zjs_glcd_alloc_msg()
 {
-    zjs_ipm_message_t *msg = zjs_malloc(sizeof(zjs_ipm_message_t));
+    zjs_ipm_message_t *msg = glcd_msg_pool_alloc();
     if (!msg) {
         PRINT("zjs_glcd_alloc_msg: cannot allocate message\n");
         return NULL;
@@ -42,7 +47,7 @@ static void zjs_glcd_free_msg(zjs_ipm_message_t* msg)
         return;
 
     if ((msg->flags & MSG_SAFE_TO_FREE_FLAG) == MSG_SAFE_TO_FREE_FLAG) {
-        zjs_free(msg);
+        glcd_msg_pool_free(msg);
     } else {
         PRINT("zjs_glcd_free_msg: error! do not free message\n");
     }
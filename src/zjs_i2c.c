@@ -94,12 +94,10 @@ static jerry_value_t zjs_i2c_read_base(const jerry_value_t this,
     uint32_t bus;
     zjs_obj_get_uint32(this, "bus", &bus);
     uint32_t address = (uint32_t)jerry_get_number_value(argv[0]);
-    jerry_value_t buf_obj = zjs_buffer_create(size);
     zjs_buffer_t *buf;
+    jerry_value_t buf_obj = zjs_buffer_create(size, &buf);
 
-    if (jerry_value_is_object(buf_obj)) {
-        buf = zjs_buffer_find(buf_obj);
-
+    if (buf) {
         if (!burst && (register_addr != 0)) {
             // i2c_read checks the first byte for the register address
             // i2c_burst_read doesn't
@@ -128,6 +126,7 @@ static jerry_value_t zjs_i2c_read_base(const jerry_value_t this,
     bool success = zjs_i2c_ipm_send_sync(&send, &reply);
 
     if (!success) {
+        jerry_release_value(buf_obj);
         return zjs_error("zjs_i2c_read_base: ipm message failed or timed out!");
     }
 
@@ -6,22 +6,14 @@
 #include "zjs_util.h"
 #include <unistd.h>
 
-typedef struct zjs_port_timer {
-    uint32_t sec;
-    uint32_t milli;
-    uint32_t interval;
-    void* data;
-} zjs_port_timer_t;
-
-void zjs_port_timer_init(zjs_port_timer_t* timer, void* data);
-
-void zjs_port_timer_start(zjs_port_timer_t* timer, uint32_t interval);
-
-void zjs_port_timer_stop(zjs_port_timer_t* timer);
-
-uint8_t zjs_port_timer_test(zjs_port_timer_t* timer, uint32_t ticks);
+/*
+ * Get the time since startup in ticks of 1/CONFIG_SYS_CLOCK_TICKS_PER_SEC
+ * seconds. The value wraps around, so compare two readings by subtracting them.
+ */
+uint32_t zjs_port_timer_get_uptime(void);
 
 #define ZJS_TICKS_NONE          0
+#define ZJS_TICKS_FOREVER       -1
 #define CONFIG_SYS_CLOCK_TICKS_PER_SEC 100
 #define zjs_sleep usleep
 
@@ -0,0 +1,268 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifdef ZJS_LINUX_BUILD
+#include <stdlib.h>
+#else
+#include <zephyr.h>
+#endif
+
+#include <string.h>
+
+#include "zjs_mem.h"
+#include "zjs_pool.h"
+#include "zjs_util.h"
+
+#ifndef ZJS_POOL_CONFIG
+#ifdef ZJS_LINUX_BUILD
+#define mem_malloc(sz) malloc(sz)
+#define mem_free(ptr) free(ptr)
+#else
+#define mem_malloc(sz) task_malloc(sz)
+#define mem_free(ptr) task_free(ptr)
+#endif
+
+// heap blocks have no pool header to keep the owner in, so they get their
+//   own; it is rounded up to two pointers, so the memory after it keeps the
+//   heap's alignment
+typedef struct mem_header {
+    uint32_t size;
+    uint8_t owner;
+} mem_header_t;
+
+#define MEM_ALIGN       (2 * sizeof(void *))
+#define MEM_HEADER_SIZE \
+    ((sizeof(mem_header_t) + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1))
+#endif  // ZJS_POOL_CONFIG
+
+// Owner IDs 1 to ZJS_MEM_MAX_MODULES are modules, and the ones after that
+//   call sites; 0 is a call site that hasn't allocated yet
+#define MODULE_OWNER(index) ((index) + 1)
+#define SITE_OWNER(index)   ((index) + 1 + ZJS_MEM_MAX_MODULES)
+
+#ifdef ZJS_MEM_SITES
+typedef char owners_fit_byte[SITE_OWNER(ZJS_MEM_MAX_SITES - 1) <= UINT8_MAX ?
+                             1 : -1];
+#endif
+
+static zjs_mem_stats_t total;
+static zjs_mem_module_t modules[ZJS_MEM_MAX_MODULES];
+static int num_modules = 0;
+#ifdef ZJS_MEM_SITES
+static zjs_mem_site_t sites[ZJS_MEM_MAX_SITES];
+static int num_sites = 0;
+#endif
+
+static int find_module(const char *file)
+{
+    // effects: returns the index of the module for source file, adding it if
+    //            it's new; once the table is full, new modules share the last
+    //            entry
+    const char *name = strrchr(file, '/');
+    name = name ? name + 1 : file;
+    if (!strncmp(name, "zjs_", 4)) {
+        name += 4;
+    }
+    int len = strcspn(name, ".");
+    if (len >= ZJS_MEM_NAME_SIZE) {
+        len = ZJS_MEM_NAME_SIZE - 1;
+    }
+
+    for (int i = 0; i < num_modules; i++) {
+        if (!strncmp(modules[i].name, name, len) &&
+            modules[i].name[len] == '\0') {
+            return i;
+        }
+    }
+
+    if (num_modules == ZJS_MEM_MAX_MODULES) {
+        return ZJS_MEM_MAX_MODULES - 1;
+    }
+    zjs_mem_module_t *module = &modules[num_modules];
+    memcpy(module->name, name, len);
+    module->name[len] = '\0';
+    return num_modules++;
+}
+
+static uint8_t new_owner(const char *file, uint32_t line)
+{
+    // effects: returns the owner ID for a call site allocating for the first
+    //            time: its own, if it gets a site entry, or else its module's
+    int module = find_module(file);
+#ifdef ZJS_MEM_SITES
+    if (num_sites < ZJS_MEM_MAX_SITES) {
+        zjs_mem_site_t *site = &sites[num_sites];
+        site->file = file;
+        site->line = line;
+        site->module = &modules[module];
+        return SITE_OWNER(num_sites++);
+    }
+#endif
+    return MODULE_OWNER(module);
+}
+
+static void stats_alloc(zjs_mem_stats_t *stats, uint32_t size)
+{
+    stats->allocs++;
+    stats->live += size;
+    if (stats->peak < stats->live) {
+        stats->peak = stats->live;
+    }
+}
+
+static void count(uint8_t owner, uint32_t size, bool alloc, bool failed)
+{
+    // effects: counts an allocation of size bytes, a failed one, or the
+    //            free of one, against owner, its module and the total
+    zjs_mem_stats_t *counters[3] = { &total, NULL, NULL };
+    if (owner > ZJS_MEM_MAX_MODULES) {
+#ifdef ZJS_MEM_SITES
+        zjs_mem_site_t *site = &sites[owner - SITE_OWNER(0)];
+        counters[1] = &site->module->stats;
+        counters[2] = &site->stats;
+#endif
+    } else if (owner) {
+        counters[1] = &modules[owner - MODULE_OWNER(0)].stats;
+    }
+
+    for (int i = 0; i < 3 && counters[i]; i++) {
+        if (failed) {
+            counters[i]->failures++;
+        } else if (alloc) {
+            stats_alloc(counters[i], size);
+        } else {
+            counters[i]->live -= size;
+        }
+    }
+}
+
+void *zjs_mem_alloc(uint8_t *owner, const char *file, uint32_t line,
+                    uint32_t size)
+{
+    if (!*owner) {
+        *owner = new_owner(file, line);
+    }
+
+#ifdef ZJS_POOL_CONFIG
+    void *ptr = pool_malloc(size);
+    if (ptr) {
+        pool_set_owner(ptr, *owner);
+    }
+#else
+    void *ptr = NULL;
+    mem_header_t *header = mem_malloc(MEM_HEADER_SIZE + size);
+    if (header) {
+        header->size = size;
+        header->owner = *owner;
+        ptr = (uint8_t *)header + MEM_HEADER_SIZE;
+    }
+#endif
+#ifdef ZJS_TRACE_MALLOC
+    PRINT("%s:%lu: allocating %lu bytes (%p)\n", file, (unsigned long)line,
+          (unsigned long)size, ptr);
+#endif
+
+    count(*owner, size, true, ptr == NULL);
+    return ptr;
+}
+
+void zjs_mem_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+#ifdef ZJS_POOL_CONFIG
+    uint8_t owner;
+    uint32_t size;
+    if (pool_get_owner(ptr, &owner, &size)) {
+        count(owner, size, false, false);
+    }
+    pool_free(ptr);
+#else
+    mem_header_t *header = (mem_header_t *)((uint8_t *)ptr - MEM_HEADER_SIZE);
+    count(header->owner, header->size, false, false);
+    mem_free(header);
+#endif
+}
+
+const zjs_mem_stats_t *zjs_mem_total(void)
+{
+    return &total;
+}
+
+const zjs_mem_module_t *zjs_mem_get_module(int index)
+{
+    return index < num_modules ? &modules[index] : NULL;
+}
+
+#ifdef ZJS_MEM_SITES
+const zjs_mem_site_t *zjs_mem_get_site(int index)
+{
+    return index < num_sites ? &sites[index] : NULL;
+}
+#endif
+
+static void add_stats(jerry_value_t obj, const zjs_mem_stats_t *stats)
+{
+    zjs_obj_add_number(obj, stats->live, "live");
+    zjs_obj_add_number(obj, stats->peak, "peak");
+    zjs_obj_add_number(obj, stats->allocs, "allocs");
+    zjs_obj_add_number(obj, stats->failures, "failures");
+}
+
+static jerry_value_t zjs_memory_usage(const jerry_value_t function_obj,
+                                      const jerry_value_t this,
+                                      const jerry_value_t argv[],
+                                      const jerry_length_t argc)
+{
+    // args: [sites]
+    // effects: returns the total counters, with an object of counters per
+    //            module as 'modules', and if sites is true in a MEMSTATS=on
+    //            build, an array of them per call site as 'sites'
+    jerry_value_t usage = jerry_create_object();
+    add_stats(usage, &total);
+
+    jerry_value_t modules_obj = jerry_create_object();
+    for (int i = 0; i < num_modules; i++) {
+        jerry_value_t module_obj = jerry_create_object();
+        add_stats(module_obj, &modules[i].stats);
+        zjs_obj_add_object(modules_obj, module_obj, modules[i].name);
+        jerry_release_value(module_obj);
+    }
+    zjs_obj_add_object(usage, modules_obj, "modules");
+    jerry_release_value(modules_obj);
+
+#ifdef ZJS_MEM_SITES
+    if (argc >= 1 && jerry_value_is_boolean(argv[0]) &&
+        jerry_get_boolean_value(argv[0])) {
+        jerry_value_t array = jerry_create_array(num_sites);
+        for (int i = 0; i < num_sites; i++) {
+            jerry_value_t site_obj = jerry_create_object();
+            zjs_obj_add_string(site_obj, sites[i].file, "file");
+            zjs_obj_add_number(site_obj, sites[i].line, "line");
+            add_stats(site_obj, &sites[i].stats);
+            jerry_release_value(jerry_set_property_by_index(array, i,
+                                                            site_obj));
+            jerry_release_value(site_obj);
+        }
+        zjs_obj_add_object(usage, array, "sites");
+        jerry_release_value(array);
+    }
+#endif
+
+    return usage;
+}
+
+void zjs_mem_init(void)
+{
+    jerry_value_t global_obj = jerry_get_global_object();
+    jerry_value_t process = zjs_get_property(global_obj, "process");
+    if (!jerry_value_is_object(process)) {
+        jerry_release_value(process);
+        process = jerry_create_object();
+        zjs_obj_add_object(global_obj, process, "process");
+    }
+    zjs_obj_add_function(process, zjs_memory_usage, "memoryUsage");
+    jerry_release_value(process);
+    jerry_release_value(global_obj);
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __zjs_mem_h__
+#define __zjs_mem_h__
+
+// Allocation counters by module, kept by zjs_malloc in every build, and by
+// call site too in builds with MEMSTATS=on. Each zjs_malloc call site caches
+// the owner ID it counts against in a static byte, and each block records its
+// owner so zjs_free can count it against the same one: in the pool header
+// with MALLOC=pool, so the pools are sized the same as without counters, and
+// in a small header in front of heap allocations otherwise. The module is the
+// source file name without the zjs_ prefix, so zjs_ble.c counts as "ble".
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ZJS_MEM_MAX_MODULES 16
+#define ZJS_MEM_NAME_SIZE   12
+// call sites past this many are only counted by module; owner IDs are a byte,
+//   shared with the modules
+#define ZJS_MEM_MAX_SITES   64
+
+typedef struct zjs_mem_stats {
+    uint32_t live;          // bytes allocated now
+    uint32_t peak;          // most bytes allocated at once
+    uint32_t allocs;        // successful allocations
+    uint32_t failures;      // allocations that returned NULL
+} zjs_mem_stats_t;
+
+typedef struct zjs_mem_module {
+    char name[ZJS_MEM_NAME_SIZE];
+    zjs_mem_stats_t stats;
+} zjs_mem_module_t;
+
+#ifdef ZJS_MEM_SITES
+typedef struct zjs_mem_site {
+    const char *file;
+    uint32_t line;
+    zjs_mem_stats_t stats;
+    zjs_mem_module_t *module;
+} zjs_mem_site_t;
+#endif
+
+/*
+ * Allocate memory on behalf of a call site; use zjs_malloc instead
+ *
+ * @param owner         The call site's owner ID, 0 until it first allocates
+ * @param file          Source file of the call site
+ * @param line          Line of the call site
+ * @param size          Bytes to allocate
+ * @return              The new memory, or NULL if out of memory
+ */
+void *zjs_mem_alloc(uint8_t *owner, const char *file, uint32_t line,
+                    uint32_t size);
+
+/*
+ * Free memory from zjs_mem_alloc and update its owner; use zjs_free instead
+ */
+void zjs_mem_free(void *ptr);
+
+/*
+ * Counters over all allocations
+ */
+const zjs_mem_stats_t *zjs_mem_total(void);
+
+/*
+ * Get the counters for a module
+ *
+ * @param index         Index of the module, from 0
+ * @return              The module, or NULL if index is past the last one
+ */
+const zjs_mem_module_t *zjs_mem_get_module(int index);
+
+#ifdef ZJS_MEM_SITES
+/*
+ * Get the counters for a call site
+ *
+ * @param index         Index of the call site, from 0
+ * @return              The call site, or NULL if index is past the last one
+ */
+const zjs_mem_site_t *zjs_mem_get_site(int index);
+#endif
+
+/*
+ * Add the process.memoryUsage() JS API
+ */
+void zjs_mem_init(void);
+
+#endif  // __zjs_mem_h__
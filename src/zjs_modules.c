@@ -31,6 +31,7 @@
 typedef struct module {
     const char *name;
     initcb_t init;
+    jerry_value_t instance;     // exports from the first require, or 0
 } module_t;
 
 module_t zjs_modules_array[] = {
@@ -72,6 +73,32 @@ module_t zjs_modules_array[] = {
 #endif
 };
 
+#define MODULE_COUNT (sizeof(zjs_modules_array) / sizeof(module_t))
+
+// must be a power of two, at least twice the number of modules so probes stay
+//   short
+#define MODULE_SLOTS 16
+
+typedef char module_slots_fit[MODULE_COUNT * 2 <= MODULE_SLOTS ? 1 : -1];
+
+// open-addressed table of modules by name hash; each slot holds an index into
+//   zjs_modules_array plus one, or 0 if empty
+static uint8_t module_slots[MODULE_SLOTS];
+
+static module_t *find_module(const char *name)
+{
+    // effects: returns the module called name, or NULL if there isn't one
+    uint32_t slot = zjs_hash_string(name) & (MODULE_SLOTS - 1);
+    while (module_slots[slot]) {
+        module_t *mod = &zjs_modules_array[module_slots[slot] - 1];
+        if (!strcmp(mod->name, name)) {
+            return mod;
+        }
+        slot = (slot + 1) & (MODULE_SLOTS - 1);
+    }
+    return NULL;
+}
+
 static jerry_value_t native_require_handler(const jerry_value_t function_obj,
                                             const jerry_value_t this,
                                             const jerry_value_t argv[],
@@ -91,20 +118,35 @@ static jerry_value_t native_require_handler(const jerry_value_t function_obj,
     int len = jerry_string_to_char_buffer(arg, (jerry_char_t *)module, sz);
     module[len] = '\0';
 
-    int modcount = sizeof(zjs_modules_array) / sizeof(module_t);
-    for (int i = 0; i < modcount; i++) {
-        module_t *mod = &zjs_modules_array[i];
-        if (!strcmp(mod->name, module)) {
-            return jerry_acquire_value(mod->init());
-        }
+    module_t *mod = find_module(module);
+    if (!mod) {
+        PRINT("MODULE: `%s'\n", module);
+        return zjs_error("native_require_handler: module not found");
     }
 
-    PRINT("MODULE: `%s'\n", module);
-    return zjs_error("native_require_handler: module not found");
+    // init only once, so every require shares the same exports and the
+    //   hardware is probed once; a failed init is retried next time
+    if (!mod->instance) {
+        jerry_value_t instance = mod->init();
+        if (jerry_value_has_error_flag(instance)) {
+            return instance;
+        }
+        mod->instance = instance;
+    }
+    return jerry_acquire_value(mod->instance);
 }
 
 void zjs_modules_init()
 {
+    for (int i = 0; i < MODULE_COUNT; i++) {
+        uint32_t slot = zjs_hash_string(zjs_modules_array[i].name) &
+                        (MODULE_SLOTS - 1);
+        while (module_slots[slot]) {
+            slot = (slot + 1) & (MODULE_SLOTS - 1);
+        }
+        module_slots[slot] = i + 1;
+    }
+
     jerry_value_t global_obj = jerry_get_global_object();
 
     // create the C handler for require JS call
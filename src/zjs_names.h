@@ -0,0 +1,49 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __zjs_names_h__
+#define __zjs_names_h__
+
+#include "jerry-api.h"
+
+// Property names used on hot paths. Each one is created as a JS string once,
+// at startup, and stays acquired until zjs_names_cleanup(), so lookups can use
+// ZJS_NAME(id) directly instead of building the string every time.
+//
+// To add a name, add X(id, "string") below; the id must be a valid C
+// identifier.
+#define ZJS_NAME_LIST(X)                \
+    X(event,        "\377event")        \
+    X(activeLow,    "activeLow")        \
+    X(catch,        "catch")            \
+    X(device,       "device")           \
+    X(length,       "length")           \
+    X(onchange,     "onchange")         \
+    X(pin,          "pin")              \
+    X(promise,      "promise")          \
+    X(then,         "then")             \
+    X(value,        "value")
+
+#define ZJS_NAME_ENUM(id, str) ZJS_NAME_##id,
+enum zjs_name_id {
+    ZJS_NAME_LIST(ZJS_NAME_ENUM)
+    ZJS_NAME_COUNT
+};
+#undef ZJS_NAME_ENUM
+
+extern jerry_value_t zjs_names[ZJS_NAME_COUNT];
+
+// Well-known name as a JS string value, owned by the names table; don't
+// release it
+#define ZJS_NAME(id) (zjs_names[ZJS_NAME_##id])
+
+/*
+ * Create the well-known name strings; call after jerry_init()
+ */
+void zjs_names_init(void);
+
+/*
+ * Release the well-known and cached name strings; call before jerry_cleanup()
+ */
+void zjs_names_cleanup(void);
+
+#endif  // __zjs_names_h__
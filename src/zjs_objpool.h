@@ -0,0 +1,77 @@
+// Copyright (c) 2016, Intel Corporation.
+
+#ifndef __zjs_objpool_h__
+#define __zjs_objpool_h__
+
+#include <stdint.h>
+
+#include "zjs_util.h"
+
+// Fixed-size pools for native structs that are created and destroyed all the
+// time, so the main loop doesn't have to go through the allocator for them.
+// Objects come from static storage while it lasts, and from zjs_malloc after
+// that; freed objects are kept on a free list linked through their first word,
+// and ones from the heap go back to it.
+//
+// ZJS_OBJPOOL(name, type, count) declares a pool of count objects of type,
+// with type *name_alloc(void) and void name_free(type *) to use it; like
+// zjs_malloc, the memory is not cleared. Objects from the heap are counted
+// against the module that declares the pool, in zjs_mem.
+
+typedef struct zjs_objpool {
+    uint8_t *objs;      // static storage for count objects
+    uint16_t size;      // size of each object
+    uint16_t count;
+    uint16_t carved;    // objects from objs handed out at least once
+    void *free;         // objects given back, ready for reuse
+    const char *file;   // where the pool is declared, for zjs_mem
+    uint32_t line;
+    uint8_t owner;      // zjs_mem owner ID of heap objects, as in zjs_malloc
+} zjs_objpool_t;
+
+static inline void *zjs_objpool_alloc(zjs_objpool_t *pool)
+{
+    // effects: returns an object from the pool, or from the heap once the
+    //            pool is used up; NULL if out of memory
+    void *obj = pool->free;
+    if (obj) {
+        pool->free = *(void **)obj;
+        return obj;
+    }
+    if (pool->carved < pool->count) {
+        return pool->objs + pool->size * pool->carved++;
+    }
+    return zjs_mem_alloc(&pool->owner, pool->file, pool->line, pool->size);
+}
+
+static inline void zjs_objpool_free(zjs_objpool_t *pool, void *obj)
+{
+    // requires: obj came from zjs_objpool_alloc on pool, or is NULL
+    //  effects: makes obj available again
+    uint8_t *ptr = obj;
+    if (ptr >= pool->objs && ptr < pool->objs + pool->size * pool->count) {
+        *(void **)obj = pool->free;
+        pool->free = obj;
+    } else {
+        zjs_free(obj);
+    }
+}
+
+// the free list needs room for a pointer in each object
+#define ZJS_OBJPOOL(name, type, count)                                        \
+    typedef char name##_fits_link[sizeof(type) >= sizeof(void *) ? 1 : -1];   \
+    static type name##_objs[count];                                           \
+    static zjs_objpool_t name = {                                             \
+        (uint8_t *)name##_objs, sizeof(type), count, 0, NULL,                 \
+        __FILE__, __LINE__, 0                                                 \
+    };                                                                        \
+    static inline type *name##_alloc(void)                                    \
+    {                                                                         \
+        return zjs_objpool_alloc(&name);                                      \
+    }                                                                         \
+    static inline void name##_free(type *obj)                                 \
+    {                                                                         \
+        zjs_objpool_free(&name, obj);                                         \
+    }
+
+#endif  // __zjs_objpool_h__
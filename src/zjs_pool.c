@@ -1,7 +1,11 @@
 // Copyright (c) 2016, Intel Corporation.
 
 #ifdef ZJS_POOL_CONFIG
+#ifdef ZJS_LINUX_BUILD
+#include <stdlib.h>
+#else
 #include <zephyr.h>
+#endif
 
 #include <string.h>
 
@@ -9,11 +13,31 @@
 #include "zjs_util.h"
 
 /*
+ * Every block handed out starts with a 4-byte pool_header_t that records
+ * which pool it came from and the size it was allocated with, so pool_free
+ * can release it without searching for it, and there is no limit on the
+ * number of live allocations. It also has a byte for the zjs_mem owner of
+ * the block, so the always-on memory counters cost no extra RAM per block.
+ * The pools in prj.mdef are sized 4 bytes bigger than their names (POOL_8
+ * has 12 byte blocks, and so on) to make room.
+ *
+ * On Linux (make linux MALLOC=pool) the Zephyr memory pools are replaced by
+ * slabs with the same size classes: each class gets one slab of as many
+ * blocks as the device pool has, and keeps a free list of them. Like the
+ * device, a class that runs out fails the allocation and prints POOL_FAIL, so
+ * scripts that would run out of pool memory on the device fail the same way
+ * on the host, and allocation costs, size class use and waste can be measured
+ * off-device with the same DUMP_MEM_STATS output. With POOLGROW=on
+ * (ZJS_POOL_GROW) a class that runs out grows by another slab instead, to
+ * profile a script whose needs are still unknown.
+ *
  * Overhead:
  *
- * pool_map_t:      ptr = 4 bytes
- *                  req_size = 4 bytes
- *                  total = 8 bytes
+ * pool_header_t:   req_size = 2 bytes
+ *                  owner = 1 byte
+ *                  index = 4 bits
+ *                  magic = 4 bits
+ *                  total = 4 bytes per block
  *
  * pool_lookup_t:   size = 4 bytes
  *                  pool_id = 4 bytes
@@ -23,49 +47,90 @@
  *                  8 * 6
  *                  = 48 bytes
  *
- * pointer_map:     sizeof(pool_map_t) * MAX_CONCURRENT_POINTERS
- *                  8 * 64
- *                  = 512 bytes
+ * headers:         4 * (64 + 32 + 16 + 10 + 4 + 2) blocks in the default pools
+ *                  = 512 bytes, the same as the old 64-entry pointer map
  *
- * total overhead:  48 + 512
- *                  = 560 bytes
- *
- *
- * TODO: Find a better way to generate the pool sizes and max concurrent
- *       pointers. There should be a way to choose the values based on a static
- *       analysis of the script, looking at what modules are being used and how
- *       many malloc's each does.
+ * The pools come from ZJS_POOL_LIST. To fit them to a script, build with
+ * TRACE=full and run it: every time the number of live requests of some size
+ * reaches a new peak, a POOL_PEAK line is printed. Requests are counted before
+ * they are tried, so ones that fail raise the peak too. scripts/genpools reads
+ * those lines and the POOL_FAIL ones from the log and picks the sizes and
+ * block counts that cover the peaks with the least RAM, as a POOLS setting
+ * for the build. On Linux, profile with POOLGROW=on, so that a class that runs
+ * out keeps serving the script and the peaks past it are seen too.
  */
 
-typedef struct pool_map {
-    void* ptr;
-    uint32_t req_size;
-#ifdef DUMP_MEM_STATS
-    uint32_t pool_size;
-#endif
-} pool_map_t;
+typedef struct pool_header {
+    // size passed to task_mem_pool_alloc, header included
+    uint16_t req_size;
+    // zjs_mem owner ID the block is counted against, 0 if none
+    uint8_t owner;
+    // index into lookup[] of the pool the block came from
+    uint8_t index:4;
+    // POOL_MAGIC while the block is allocated, to catch bad and double frees
+    uint8_t magic:4;
+} pool_header_t;
+
+#define POOL_MAGIC  0xa
+
+// the data after the header must be aligned for any type, which on 64-bit
+//   Linux takes more than the 4 bytes of the header
+#define POOL_ALIGN          (sizeof(void *) > 4 ? sizeof(void *) : 4)
+#define POOL_ALIGN_UP(n)    (((n) + POOL_ALIGN - 1) & ~(POOL_ALIGN - 1))
+#define POOL_HEADER_SIZE    POOL_ALIGN_UP(sizeof(pool_header_t))
 
 typedef struct pool_lookup {
     uint32_t size;
+#ifdef ZJS_LINUX_BUILD
+    uint32_t slab_blocks;
+#else
     uint32_t pool_id;
+#endif
 } pool_lookup_t;
 
+// size is the largest allocation each pool can satisfy, not counting the
+//   header; on Linux, slab_blocks matches the block count of the device pool
+#ifdef ZJS_LINUX_BUILD
+#define POOL_LOOKUP(size, blocks) { size, blocks },
+#else
+#define POOL_LOOKUP(size, blocks) { size, POOL_##size },
+#endif
 static pool_lookup_t lookup[] = {
-    { 8,    POOL_8 },
-    { 16,   POOL_16 },
-    { 36,   POOL_36 },
-    { 64,   POOL_64 },
-    { 128,  POOL_128 },
-    { 256,  POOL_256 }
+    ZJS_POOL_LIST(POOL_LOOKUP)
 };
+#undef POOL_LOOKUP
 
-#define MAX_CONCURRENT_POINTERS  64
+#define NUM_POOLS  (sizeof(lookup) / sizeof(lookup[0]))
 
-static pool_map_t pointer_map[MAX_CONCURRENT_POINTERS];
-
-#define POOL_SIZE_TOO_SMALL     0xFFFFFFFF
+// the header keeps the pool index in 4 bits
+typedef char pool_index_fits[NUM_POOLS <= 16 ? 1 : -1];
 
 #ifdef DUMP_MEM_STATS
+typedef struct pool_stats {
+    uint32_t used;          // blocks currently allocated
+    uint32_t max_used;      // most blocks allocated at once
+    uint32_t req_bytes;     // bytes requested by the blocks in use
+    uint32_t min_size;      // smallest request seen
+    uint32_t max_size;      // largest request seen
+    uint32_t failures;      // allocations that found the pool empty
+    uint32_t max_waste;     // most bytes lost to rounding up at once
+} pool_stats_t;
+
+static pool_stats_t stats[NUM_POOLS];
+
+// live allocations and their peak for each request size, in steps of
+//   PROFILE_GRAIN bytes up to PROFILE_MAX_SIZE, for scripts/genpools
+#define PROFILE_GRAIN       4
+#define PROFILE_MAX_SIZE    512
+#define PROFILE_BUCKETS     (PROFILE_MAX_SIZE / PROFILE_GRAIN)
+
+typedef struct size_profile {
+    uint16_t live;
+    uint16_t peak;
+} size_profile_t;
+
+static size_profile_t profile[PROFILE_BUCKETS];
+
 static uint32_t mem_high_water = 0;
 static uint32_t mem_in_use = 0;
 static uint32_t pointers_used = 0;
@@ -77,174 +142,308 @@ void zjs_print_pools(void)
     int i;
     uint32_t total_waste = 0;
     PRINT("\nDumping pools:\n");
-    for (i = 0; i < (sizeof(lookup) / sizeof(lookup[0])); ++i) {
-        int j;
-        uint32_t cur_use = 0;
-        uint32_t cur_waste = 0;
-        uint32_t min_size = lookup[i].size;
-        uint32_t max_size = lookup[i].size;
-        PRINT("Pool size: %lu\n", lookup[i].size);
-        for (j = 0; j < MAX_CONCURRENT_POINTERS; ++j) {
-            if (pointer_map[j].ptr && pointer_map[j].pool_size == lookup[i].size) {
-                cur_use++;
-                cur_waste += lookup[i].size - pointer_map[j].req_size;
-                if (min_size > pointer_map[j].req_size) {
-                    min_size = pointer_map[j].req_size;
-                }
-                if (max_size < pointer_map[j].req_size) {
-                    max_size = pointer_map[j].req_size;
-                }
-            }
-        }
-        PRINT("\tBlocks Used: %lu, Memory Used: %lu, Memory Waste: %lu\n", cur_use, cur_use * lookup[i].size, cur_waste);
-        PRINT("\tMin Size: %lu, Max Size: %lu\n", min_size, max_size);
+    for (i = 0; i < NUM_POOLS; ++i) {
+        pool_stats_t *pool = &stats[i];
+        uint32_t cur_waste = pool->used * lookup[i].size - pool->req_bytes;
+        PRINT("Pool size: %lu\n", (unsigned long)lookup[i].size);
+        PRINT("\tBlocks Used: %lu, Max Used: %lu, Memory Used: %lu, Memory Waste: %lu\n",
+              (unsigned long)pool->used, (unsigned long)pool->max_used,
+              (unsigned long)(pool->used * lookup[i].size),
+              (unsigned long)cur_waste);
+        PRINT("\tMin Size: %lu, Max Size: %lu, Failures: %lu, Max Waste: %lu\n",
+              (unsigned long)pool->min_size, (unsigned long)pool->max_size,
+              (unsigned long)pool->failures, (unsigned long)pool->max_waste);
         total_waste += cur_waste;
     }
     if (max_waste < total_waste) {
         max_waste = total_waste;
     }
-    PRINT("Memory Used: %lu, High Water: %lu\n", mem_in_use, mem_high_water);
-    PRINT("Memory Waste: %lu, Max Waste: %lu\n", total_waste, max_waste);
-    PRINT("Pointers Used: %lu, Max Used: %lu\n", pointers_used, max_pointers_used);
+    PRINT("Memory Used: %lu, High Water: %lu\n", (unsigned long)mem_in_use,
+          (unsigned long)mem_high_water);
+    PRINT("Memory Waste: %lu, Max Waste: %lu\n", (unsigned long)total_waste,
+          (unsigned long)max_waste);
+    PRINT("Pointers Used: %lu, Max Used: %lu\n", (unsigned long)pointers_used,
+          (unsigned long)max_pointers_used);
+}
+
+static size_profile_t *profile_bucket(uint32_t size)
+{
+    //  effects: returns the profile entry that counts requests of size bytes,
+    //             or NULL if it is too big to track
+    uint32_t bucket = size ? (size - 1) / PROFILE_GRAIN : 0;
+    return bucket < PROFILE_BUCKETS ? &profile[bucket] : NULL;
+}
+
+static void profile_alloc(uint32_t size)
+{
+    size_profile_t *entry = profile_bucket(size);
+    if (!entry) {
+        return;
+    }
+    entry->live++;
+    if (entry->peak < entry->live) {
+        entry->peak = entry->live;
+        // the format scripts/genpools looks for
+        PRINT("POOL_PEAK size=%lu peak=%lu\n",
+              (unsigned long)((entry - profile + 1) * PROFILE_GRAIN),
+              (unsigned long)entry->peak);
+    }
+}
+
+static void profile_free(uint32_t size)
+{
+    size_profile_t *entry = profile_bucket(size);
+    if (entry) {
+        entry->live--;
+    }
+}
+
+static void stats_alloc(int index, uint32_t size)
+{
+    pool_stats_t *pool = &stats[index];
+    pool->used++;
+    if (pool->max_used < pool->used) {
+        pool->max_used = pool->used;
+    }
+    pool->req_bytes += size;
+    if (pool->min_size == 0 || pool->min_size > size) {
+        pool->min_size = size;
+    }
+    if (pool->max_size < size) {
+        pool->max_size = size;
+    }
+    uint32_t waste = pool->used * lookup[index].size - pool->req_bytes;
+    if (pool->max_waste < waste) {
+        pool->max_waste = waste;
+    }
+
+    mem_in_use += size;
+    if (mem_in_use > mem_high_water) {
+        mem_high_water = mem_in_use;
+    }
+    pointers_used++;
+    if (max_pointers_used < pointers_used) {
+        max_pointers_used = pointers_used;
+    }
+}
+
+static void stats_free(int index, uint32_t size)
+{
+    profile_free(size);
+
+    stats[index].used--;
+    stats[index].req_bytes -= size;
+    mem_in_use -= size;
+    pointers_used--;
 }
 #else
 #define zjs_print_pools(void) do {} while (0);
 #endif
 
-void zjs_init_mem_pools(void)
+#ifdef ZJS_LINUX_BUILD
+// free blocks of each slab class are linked through their data area, so the
+//   header stays intact and pool_free can still catch a double free
+#define SLAB_LINK(block) ((void **)((uint8_t *)(block) + POOL_HEADER_SIZE))
+
+static void *free_list[NUM_POOLS];
+// slabs carved for each pool so far
+static uint8_t slabs[NUM_POOLS];
+
+static bool slab_grow(int index)
 {
-    int i;
-    for (i = 0; i < MAX_CONCURRENT_POINTERS; ++i) {
-#ifdef DUMP_MEM_STATS
-        pointer_map[i].req_size = 0;
+    // effects: carves a new slab into blocks for pool index and puts them on
+    //            its free list; returns false if out of memory, or if the pool
+    //            already has its one slab and growing isn't enabled
+#ifndef ZJS_POOL_GROW
+    if (slabs[index]) {
+        return false;
+    }
 #endif
-        pointer_map[i].ptr = NULL;
+    uint32_t stride = POOL_ALIGN_UP(POOL_HEADER_SIZE + lookup[index].size);
+    uint32_t count = lookup[index].slab_blocks;
+    uint8_t *slab = malloc(stride * count);
+    if (!slab) {
+        return false;
+    }
+    slabs[index]++;
+
+    // slabs are never given back, just like the fixed pools on the device
+    for (int i = count - 1; i >= 0; --i) {
+        void *block = slab + i * stride;
+        *SLAB_LINK(block) = free_list[index];
+        free_list[index] = block;
     }
+    return true;
 }
 
-static uint32_t find_pool_id(uint32_t size)
+static void *block_alloc(int index, uint32_t req_size)
 {
-    int i;
-    for (i = 0; i < (sizeof(lookup) / sizeof(lookup[0])); ++i) {
-        if (size <= lookup[i].size) {
-            return lookup[i].pool_id;
-        }
+    // effects: pops a block off the free list of pool index, or returns NULL
+    if (!free_list[index] && !slab_grow(index)) {
+        return NULL;
     }
-    DBG_PRINT("no pool ID found\n");
-    return 0;
+    void *block = free_list[index];
+    free_list[index] = *SLAB_LINK(block);
+    return block;
 }
 
-#ifdef DUMP_MEM_STATS
-static void add_pointer(void* ptr, uint32_t req_size, uint32_t size, uint32_t pool_size)
+static void block_free(int index, void *ptr, uint32_t req_size)
+{
+    // effects: pushes the block at ptr back on the free list of pool index
+    *SLAB_LINK(ptr) = free_list[index];
+    free_list[index] = ptr;
+}
 #else
-static void add_pointer(void* ptr, uint32_t req_size)
-
-#endif
+static void *block_alloc(int index, uint32_t req_size)
 {
-    int i;
-    for (i = 0; i < MAX_CONCURRENT_POINTERS; ++i) {
-        if (pointer_map[i].ptr == NULL) {
-            pointer_map[i].ptr = ptr;
-            pointer_map[i].req_size = req_size;
-#ifdef DUMP_MEM_STATS
-            pointer_map[i].req_size = size;
-            pointer_map[i].pool_size = pool_size;
-            mem_in_use += size;
-            if (mem_in_use > mem_high_water) {
-                mem_high_water = mem_in_use;
-            }
-#endif
-            return;
-        }
+    // effects: allocates req_size bytes from Zephyr pool index, or returns
+    //            NULL
+    struct k_block block;
+    int ret = task_mem_pool_alloc(&block, lookup[index].pool_id, req_size,
+                                  TICKS_NONE);
+    if (ret != RC_OK) {
+        DBG_PRINT("task_mem_pool_alloc() returned an error: %u\n", ret);
+        return NULL;
     }
+    return block.pointer_to_data;
 }
 
-#ifdef DUMP_MEM_STATS
-static uint32_t lookup_pool(uint32_t size, uint32_t* pool_size)
-#else
-static uint32_t lookup_pool(uint32_t size)
+static void block_free(int index, void *ptr, uint32_t req_size)
+{
+    // effects: returns the block at ptr, allocated with req_size, to Zephyr
+    //            pool index
+    struct k_block block;
+    block.address_in_pool = ptr;
+    block.pointer_to_data = ptr;
+    block.req_size = req_size;
+    block.pool_id = lookup[index].pool_id;
+    task_mem_pool_free(&block);
+}
+#endif
 
+void zjs_init_mem_pools(void)
+{
+#ifdef DUMP_MEM_STATS
+    memset(stats, 0, sizeof(stats));
+    memset(profile, 0, sizeof(profile));
 #endif
+}
+
+static int lookup_pool(uint32_t size)
 {
+    // effects: returns the index of the smallest pool with blocks that hold
+    //            size bytes, or -1 if there is none
     int i;
-    for (i = 0; i < (sizeof(lookup) / sizeof(lookup[0])); ++i) {
+    for (i = 0; i < NUM_POOLS; ++i) {
         if (size <= lookup[i].size) {
-#ifdef DUMP_MEM_STATS
-            *pool_size = lookup[i].size;
-#endif
-            return lookup[i].pool_id;
+            return i;
         }
     }
-    return POOL_SIZE_TOO_SMALL;
+    return -1;
 }
 
 void* pool_malloc(uint32_t size)
 {
-    int ret;
-    struct k_block block;
-    uint32_t pool;
 #ifdef DUMP_MEM_STATS
-    uint32_t pool_size;
-    pool = lookup_pool(size, &pool_size);
-#else
-    pool = lookup_pool(size);
+    // count the demand before trying it, so failed requests show up in the
+    //   peaks too; they're taken back out of the live count below
+    profile_alloc(size);
+#endif
+
+    int index = lookup_pool(size);
+    if (index < 0) {
+        DBG_PRINT("no pool size big enough for %lu bytes\n", (unsigned long)size);
+#ifdef DUMP_MEM_STATS
+        profile_free(size);
+#endif
+#if defined(DUMP_MEM_STATS) || defined(ZJS_LINUX_BUILD)
+        PRINT("POOL_FAIL size=%lu\n", (unsigned long)size);
 #endif
-    if (pool == POOL_SIZE_TOO_SMALL) {
-        DBG_PRINT("no pool size big enough for %lu bytes\n", size);
         return NULL;
     }
-    ret = task_mem_pool_alloc(&block, pool, size, TICKS_NONE);
-    if (ret != RC_OK) {
-        DBG_PRINT("task_mem_pool_alloc() returned an error: %u\n", ret);
+
+    uint32_t req_size = size + POOL_HEADER_SIZE;
+    pool_header_t *header = (pool_header_t *)block_alloc(index, req_size);
+    if (!header) {
+#ifdef DUMP_MEM_STATS
+        stats[index].failures++;
+        profile_free(size);
+#endif
+#if defined(DUMP_MEM_STATS) || defined(ZJS_LINUX_BUILD)
+        PRINT("POOL_FAIL size=%lu\n", (unsigned long)size);
+#endif
         return NULL;
     }
+
+    header->req_size = req_size;
+    header->owner = 0;
+    header->index = index;
+    header->magic = POOL_MAGIC;
+
 #ifdef DUMP_MEM_STATS
-    add_pointer(block.pointer_to_data, block.req_size, size, pool_size);
-    pointers_used++;
-    if (max_pointers_used < pointers_used) {
-        max_pointers_used = pointers_used;
-    }
-#else
-    add_pointer(block.pointer_to_data, block.req_size);
+    stats_alloc(index, size);
 #endif
 #ifdef ZJS_TRACE_MALLOC
-#ifdef DUMP_MEM_STATS
-    PRINT("\tpool size=%lu\n", pool_size);
-#endif
+    PRINT("\tpool size=%lu\n", (unsigned long)lookup[index].size);
 #endif
 
     zjs_print_pools();
 
-    return block.pointer_to_data;
+    return (uint8_t *)header + POOL_HEADER_SIZE;
+}
+
+static pool_header_t *get_header(const void *ptr)
+{
+    // effects: returns the header of the allocated block at ptr, or NULL if
+    //            it was not allocated from a pool
+    pool_header_t *header =
+        (pool_header_t *)((uint8_t *)ptr - POOL_HEADER_SIZE);
+    if (header->magic != POOL_MAGIC || header->index >= NUM_POOLS) {
+        DBG_PRINT("pool: %p was not allocated from a pool\n", ptr);
+        return NULL;
+    }
+    return header;
+}
+
+void pool_set_owner(void *ptr, uint8_t owner)
+{
+    pool_header_t *header = get_header(ptr);
+    if (header) {
+        header->owner = owner;
+    }
+}
+
+bool pool_get_owner(const void *ptr, uint8_t *owner, uint32_t *size)
+{
+    pool_header_t *header = get_header(ptr);
+    if (!header) {
+        return false;
+    }
+    *owner = header->owner;
+    *size = header->req_size - POOL_HEADER_SIZE;
+    return true;
 }
 
 void pool_free(void* ptr)
 {
-    int i;
-    for (i = 0; i < MAX_CONCURRENT_POINTERS; ++i) {
-        if (pointer_map[i].ptr == ptr) {
-            struct k_block block;
-            block.address_in_pool = pointer_map[i].ptr;
-            block.pointer_to_data = pointer_map[i].ptr;
-            block.req_size = pointer_map[i].req_size;
-            block.pool_id = find_pool_id(pointer_map[i].req_size);
+    if (!ptr) {
+        return;
+    }
+
+    pool_header_t *header = get_header(ptr);
+    if (!header) {
+        return;
+    }
+
 #ifdef DUMP_MEM_STATS
-            mem_in_use -= pointer_map[i].req_size;
-            pointers_used--;
+    stats_free(header->index, header->req_size - POOL_HEADER_SIZE);
 #endif
 #ifdef ZJS_TRACE_MALLOC
-#ifdef DUMP_MEM_STATS
-            PRINT("\tpointer size=%lu bytes\n", pointer_map[i].req_size);
-#endif
+    PRINT("\tpointer size=%lu bytes\n",
+          (unsigned long)(header->req_size - POOL_HEADER_SIZE));
 #endif
-            task_mem_pool_free(&block);
-            pointer_map[i].ptr = NULL;
-            zjs_print_pools();
-            return;
-        }
-    }
-#ifdef DUMP_MEM_STATS
+    header->magic = 0;
+    block_free(header->index, header, header->req_size);
     zjs_print_pools();
-#endif
 }
 #endif
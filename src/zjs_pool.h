@@ -3,13 +3,37 @@
 #ifndef SRC_ZJS_POOL_H_
 #define SRC_ZJS_POOL_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #ifdef ZJS_POOL_CONFIG
+// The pools as X(size, blocks), in increasing order of size; size is the
+//   largest allocation a pool serves and blocks how many it has. The build
+//   overrides this from its POOLS setting, which also generates the matching
+//   POOL_<size> lines in prj.mdef; scripts/genpools can pick them for a script
+#ifndef ZJS_POOL_LIST
+#define ZJS_POOL_LIST(X) X(8, 64) X(16, 32) X(36, 16) X(64, 10) X(128, 4) \
+                         X(256, 2)
+#endif
+
 void zjs_init_mem_pools(void);
 
 void* pool_malloc(uint32_t size);
 
 void pool_free(void* ptr);
 
+/*
+ * Record the zjs_mem owner ID of a block from pool_malloc
+ */
+void pool_set_owner(void *ptr, uint8_t owner);
+
+/*
+ * Get the zjs_mem owner ID and requested size of a block from pool_malloc
+ *
+ * @return              False if ptr was not allocated from a pool
+ */
+bool pool_get_owner(const void *ptr, uint8_t *owner, uint32_t *size);
+
 void zjs_print_pools(void);
 #endif // ZJS_POOL_CONFIG
 
@@ -4,98 +4,300 @@
 #include "zjs_util.h"
 #include "zjs_promise.h"
 #include "zjs_callbacks.h"
+#include "zjs_names.h"
+#include "zjs_objpool.h"
+
+// promises kept for reuse, more than this are heap allocated
+#define PROMISE_POOL_SIZE 4
+// then() reactions kept for reuse, more than this are heap allocated
+#define REACTION_POOL_SIZE 4
+// settled values stored in the promise itself, more than this are heap
+//   allocated
+#define PROMISE_INLINE_ARGS 1
+
+#define PROMISE_MAGIC 0x70726f6d
+
+enum promise_state {
+    PROMISE_PENDING,
+    PROMISE_FULFILLED,
+    PROMISE_REJECTED
+};
+
+struct reaction;
 
+// State of a promise object. It is the native handle of a hidden object kept
+//   in the promise's "promise" property, because the promise object itself may
+//   already have a native handle.
 struct promise {
-    uint8_t then_set;           // then() function has been set
-    jerry_value_t then;         // Function registered from then()
-    int32_t then_id;            // Callback ID for then JS callback
-    jerry_value_t* then_argv;   // Arguments for fulfilling promise
-    uint32_t then_argc;     // Number of arguments for then callback
-    uint8_t catch_set;          // catch() function has been set
-    jerry_value_t catch;        // Function registered from catch()
-    int32_t catch_id;           // Callback ID for catch JS callback
-    jerry_value_t* catch_argv;  // Arguments for rejecting promise
-    uint32_t catch_argc;    // Number of arguments for catch callback
+    uint32_t magic;             // PROMISE_MAGIC, to recognize our handles
+    uint8_t state;
+    jerry_value_t* argv;        // values it settled with
+    uint32_t argc;
+    jerry_value_t args[PROMISE_INLINE_ARGS];
+    jerry_value_t handle_obj;   // hidden object, not acquired
+    struct reaction* head;      // reactions waiting for it to settle, in order
+    struct reaction* tail;
     void* user_handle;
     zjs_post_promise_func post;
 };
 
-struct promise* new_promise(void)
+// A then() registered on a promise; once the promise settles it is queued as
+//   a microtask, which calls the handler and settles the derived promise with
+//   the result
+struct reaction {
+    struct zjs_microtask task;
+    struct promise* source;     // the promise it waits on
+    jerry_value_t source_obj;   // acquired while queued, keeps source alive
+    jerry_value_t on_fulfilled; // function, or undefined to pass through
+    jerry_value_t on_rejected;
+    struct promise* derived;    // promise returned by then()
+    jerry_value_t derived_obj;  // acquired, keeps derived alive
+    struct reaction* next;      // next in source's list while pending
+};
+
+ZJS_OBJPOOL(promise_pool, struct promise, PROMISE_POOL_SIZE)
+ZJS_OBJPOOL(reaction_pool, struct reaction, REACTION_POOL_SIZE)
+
+// then() and catch(), shared by all promises
+static jerry_value_t then_func = 0;
+static jerry_value_t catch_func = 0;
+
+static void settle_promise(struct promise* p, uint8_t state,
+                           const jerry_value_t argv[], uint32_t argc);
+static void add_reaction(struct promise* p, struct reaction* r);
+
+static struct promise* get_promise(jerry_value_t obj)
 {
-    struct promise* new = zjs_malloc(sizeof(struct promise));
-    memset(new, 0, sizeof(struct promise));
-    new->catch_id = -1;
-    new->then_id = -1;
-    return new;
+    // effects: returns the state of promise obj, or NULL if it isn't one
+    if (!jerry_value_is_object(obj)) {
+        return NULL;
+    }
+    struct promise* p = NULL;
+    uintptr_t native;
+    jerry_value_t handle_obj = jerry_get_property(obj, ZJS_NAME(promise));
+    if (jerry_value_is_object(handle_obj) &&
+        jerry_get_object_native_handle(handle_obj, &native) && native &&
+        ((struct promise*)native)->magic == PROMISE_MAGIC) {
+        p = (struct promise*)native;
+    }
+    jerry_release_value(handle_obj);
+    return p;
 }
 
-// Dummy function for then/catch
-static jerry_value_t null_function(const jerry_value_t function_obj,
-                                   const jerry_value_t this,
-                                   const jerry_value_t argv[],
-                                   const jerry_length_t argc)
+static void free_reaction(struct reaction* r)
 {
-    return ZJS_UNDEFINED;
+    jerry_release_value(r->on_fulfilled);
+    jerry_release_value(r->on_rejected);
+    jerry_release_value(r->derived_obj);
+    reaction_pool_free(r);
 }
 
-static void post_promise(void* h, jerry_value_t* ret_val)
+static void promise_free(const uintptr_t native)
 {
-    struct promise* handle = (struct promise*)h;
-    if (handle) {
-        if (handle->post) {
-            handle->post(handle->user_handle);
-        }
-        jerry_release_value(handle->then);
-        jerry_release_value(handle->catch);
+    // effects: the hidden object was garbage collected, so nothing can settle
+    //            or wait on the promise anymore
+    struct promise* p = (struct promise*)native;
+    int i;
+    for (i = 0; i < p->argc; i++) {
+        jerry_release_value(p->argv[i]);
+    }
+    if (p->argv != p->args) {
+        zjs_free(p->argv);
     }
+    while (p->head) {
+        struct reaction* r = p->head;
+        p->head = r->next;
+        free_reaction(r);
+    }
+    p->magic = 0;
+    promise_pool_free(p);
 }
 
-static void promise_free(const uintptr_t native)
+static void run_reaction(struct zjs_microtask* task)
 {
-    struct promise* handle = (struct promise*)native;
-    if (handle) {
-        zjs_free(handle);
+    // effects: calls the handler of a reaction whose promise has settled and
+    //            settles the derived promise with what it returns or throws
+    struct reaction* r = (struct reaction*)task;
+    struct promise* source = r->source;
+    bool following = false;
+    jerry_value_t handler = source->state == PROMISE_FULFILLED ?
+                            r->on_fulfilled : r->on_rejected;
+
+    if (!jerry_value_is_function(handler)) {
+        // no handler for this outcome, the derived promise gets it instead
+        settle_promise(r->derived, source->state, source->argv, source->argc);
+    } else {
+        jerry_value_t undefined = jerry_create_undefined();
+        jerry_value_t ret = jerry_call_function(handler, undefined,
+                                                source->argv, source->argc);
+        if (jerry_value_has_error_flag(ret)) {
+            jerry_value_clear_error_flag(&ret);
+            settle_promise(r->derived, PROMISE_REJECTED, &ret, 1);
+        } else {
+            struct promise* inner = get_promise(ret);
+            if (inner == r->derived) {
+                jerry_value_t error = zjs_error("promise resolved with itself");
+                jerry_value_clear_error_flag(&error);
+                settle_promise(r->derived, PROMISE_REJECTED, &error, 1);
+                jerry_release_value(error);
+            } else if (inner) {
+                // follow the returned promise by turning this reaction into a
+                //   pass-through one, like then() with no handlers; reusing it
+                //   means the derived promise can't be left pending for lack
+                //   of memory
+                jerry_release_value(r->source_obj);
+                jerry_release_value(r->on_fulfilled);
+                jerry_release_value(r->on_rejected);
+                r->on_fulfilled = jerry_create_undefined();
+                r->on_rejected = jerry_create_undefined();
+                add_reaction(inner, r);
+                following = true;
+            } else {
+                settle_promise(r->derived, PROMISE_FULFILLED, &ret, 1);
+            }
+        }
+        jerry_release_value(ret);
+    }
+
+    if (!following) {
+        jerry_release_value(r->source_obj);
+        free_reaction(r);
     }
 }
 
-static jerry_value_t* pre_then(void* h, uint32_t* argc)
+static void queue_reaction(struct promise* p, struct reaction* r)
 {
-    struct promise* handle = (struct promise*)h;
+    // requires: p has settled
+    r->source = p;
+    r->source_obj = jerry_acquire_value(p->handle_obj);
+    r->task.run = run_reaction;
+    zjs_queue_microtask(&r->task);
+}
 
-    *argc = handle->then_argc;
-    return handle->then_argv;
+static void add_reaction(struct promise* p, struct reaction* r)
+{
+    // effects: runs r once p settles, or soon if it already has
+    if (p->state != PROMISE_PENDING) {
+        queue_reaction(p, r);
+        return;
+    }
+    r->next = NULL;
+    if (p->tail) {
+        p->tail->next = r;
+    } else {
+        p->head = r;
+    }
+    p->tail = r;
 }
 
-static jerry_value_t promise_then(const jerry_value_t function_obj,
-                                   const jerry_value_t this,
-                                   const jerry_value_t argv[],
-                                   const jerry_length_t argc)
+static void settle_promise(struct promise* p, uint8_t state,
+                           const jerry_value_t argv[], uint32_t argc)
 {
-    struct promise* handle = NULL;
+    // effects: settles p with argv, acquiring them, and queues its reactions;
+    //            does nothing if p has already settled
+    if (p->state != PROMISE_PENDING) {
+        return;
+    }
+    if (argc > PROMISE_INLINE_ARGS) {
+        p->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
+        if (!p->argv) {
+            DBG_PRINT("could not allocate promise values, out of memory\n");
+            argc = 0;
+        }
+    }
+    if (argc <= PROMISE_INLINE_ARGS) {
+        p->argv = p->args;
+    }
+    int i;
+    for (i = 0; i < argc; i++) {
+        p->argv[i] = jerry_acquire_value(argv[i]);
+    }
+    p->argc = argc;
+    p->state = state;
 
-    jerry_value_t promise_obj = zjs_get_property(this, "promise");
-    jerry_get_object_native_handle(promise_obj, (uintptr_t*)&handle);
+    if (p->post) {
+        p->post(p->user_handle);
+    }
 
-    if (jerry_value_is_function(argv[0])) {
-        if (handle) {
-            jerry_release_value(handle->then);
-            handle->then = jerry_acquire_value(argv[0]);
-            zjs_edit_js_func(handle->then_id, handle->then);
-            handle->then_set = 1;
-        }
-        // Return the promise so it can be used by catch()
-        return this;
-    } else {
-        return ZJS_UNDEFINED;
+    while (p->head) {
+        struct reaction* r = p->head;
+        p->head = r->next;
+        queue_reaction(p, r);
+    }
+    p->tail = NULL;
+}
+
+static struct promise* make_promise(jerry_value_t obj,
+                                    zjs_post_promise_func post, void* handle)
+{
+    // effects: turns obj into a pending promise and returns its state, or
+    //            NULL if out of memory
+    struct promise* p = promise_pool_alloc();
+    if (!p) {
+        DBG_PRINT("could not allocate promise, out of memory\n");
+        return NULL;
     }
+    memset(p, 0, sizeof(struct promise));
+    p->magic = PROMISE_MAGIC;
+    p->state = PROMISE_PENDING;
+    p->argv = p->args;
+    p->user_handle = handle;
+    p->post = post;
+
+    jerry_value_t handle_obj = jerry_create_object();
+    jerry_set_object_native_handle(handle_obj, (uintptr_t)p, promise_free);
+    p->handle_obj = handle_obj;
+
+    jerry_set_property(obj, ZJS_NAME(then), then_func);
+    jerry_set_property(obj, ZJS_NAME(catch), catch_func);
+    jerry_set_property(obj, ZJS_NAME(promise), handle_obj);
+    jerry_release_value(handle_obj);
+    return p;
 }
 
-static jerry_value_t* pre_catch(void* h, uint32_t* argc)
+static jerry_value_t add_then(jerry_value_t this, jerry_value_t on_fulfilled,
+                              jerry_value_t on_rejected)
 {
-    struct promise* handle = (struct promise*)h;
+    // effects: registers the handlers on promise this and returns the derived
+    //            promise that settles with their result
+    struct promise* p = get_promise(this);
+    if (!p) {
+        return zjs_error("promise_then: not a promise");
+    }
+
+    struct reaction* r = reaction_pool_alloc();
+    if (!r) {
+        return zjs_error("promise_then: out of memory");
+    }
+    jerry_value_t derived_obj = jerry_create_object();
+    struct promise* derived = make_promise(derived_obj, NULL, NULL);
+    if (!derived) {
+        reaction_pool_free(r);
+        jerry_release_value(derived_obj);
+        return zjs_error("promise_then: out of memory");
+    }
+
+    r->on_fulfilled = jerry_value_is_function(on_fulfilled) ?
+                      jerry_acquire_value(on_fulfilled) :
+                      jerry_create_undefined();
+    r->on_rejected = jerry_value_is_function(on_rejected) ?
+                     jerry_acquire_value(on_rejected) :
+                     jerry_create_undefined();
+    r->derived = derived;
+    r->derived_obj = jerry_acquire_value(derived->handle_obj);
+    add_reaction(p, r);
+    return derived_obj;
+}
 
-    *argc = handle->catch_argc;
-    return handle->catch_argv;
+static jerry_value_t promise_then(const jerry_value_t function_obj,
+                                  const jerry_value_t this,
+                                  const jerry_value_t argv[],
+                                  const jerry_length_t argc)
+{
+    // args: [onFulfilled], [onRejected]
+    jerry_value_t undefined = jerry_create_undefined();
+    return add_then(this, argc >= 1 ? argv[0] : undefined,
+                    argc >= 2 ? argv[1] : undefined);
 }
 
 static jerry_value_t promise_catch(const jerry_value_t function_obj,
@@ -103,92 +305,42 @@ static jerry_value_t promise_catch(const jerry_value_t function_obj,
                                    const jerry_value_t argv[],
                                    const jerry_length_t argc)
 {
-    struct promise* handle = NULL;
-
-    jerry_value_t promise_obj = zjs_get_property(this, "promise");
-    jerry_get_object_native_handle(promise_obj, (uintptr_t*)&handle);
-
-    if (handle) {
-        if (jerry_value_is_function(argv[0])) {
-            jerry_release_value(handle->catch);
-            handle->catch = jerry_acquire_value(argv[0]);
-            zjs_edit_js_func(handle->catch_id, handle->catch);
-            handle->catch_set = 1;
-        }
-    }
-    return ZJS_UNDEFINED;
+    // args: [onRejected]
+    jerry_value_t undefined = jerry_create_undefined();
+    return add_then(this, undefined, argc >= 1 ? argv[0] : undefined);
 }
 
 void zjs_make_promise(jerry_value_t obj, zjs_post_promise_func post,
                       void* handle)
 {
-    struct promise* new = new_promise();
-    jerry_value_t promise_obj = jerry_create_object();
-
-    zjs_obj_add_function(obj, promise_then, "then");
-    zjs_obj_add_function(obj, promise_catch, "catch");
-    jerry_set_object_native_handle(promise_obj, (uintptr_t)new, promise_free);
-
-    new->user_handle = handle;
-    new->post = post;
-    new->then_set = 0;
-    new->catch_set = 0;
+    if (!then_func) {
+        then_func = jerry_create_external_function(promise_then);
+        catch_func = jerry_create_external_function(promise_catch);
+    }
 
-    // Add the "promise" object to the object passed as a property, because the
-    // object being made to a promise may already have a native handle.
-    zjs_obj_add_object(obj, promise_obj, "promise");
+    make_promise(obj, post, handle);
 
-    DBG_PRINT("created promise, obj=%lu, promise=%p, handle=%p\n", obj, new,
-              handle);
+    DBG_PRINT("created promise, obj=%lu, handle=%p\n", obj, handle);
 }
 
 void zjs_fulfill_promise(jerry_value_t obj, jerry_value_t argv[], uint32_t argc)
 {
-    struct promise* handle;
-    jerry_value_t promise_obj = zjs_get_property(obj, "promise");
-
-    jerry_get_object_native_handle(promise_obj, (uintptr_t*)&handle);
-
-    // Put *something* here in case it never gets registered
-    if (!handle->then_set) {
-        handle->then = jerry_create_external_function(null_function);
+    struct promise* p = get_promise(obj);
+    if (p) {
+        settle_promise(p, PROMISE_FULFILLED, argv, argc);
     }
 
-    handle->then_id = zjs_add_callback_once(handle->then,
-                                            obj, handle,
-                                            pre_then,
-                                            post_promise);
-    handle->then_argv = argv;
-    handle->then_argc = argc;
-
-    zjs_signal_callback(handle->then_id);
-
-    DBG_PRINT("fulfilling promise, obj=%lu, then_id=%lu, argv=%p, nargs=%lu\n",
-              obj, handle->then_id, argv, argc);
+    DBG_PRINT("fulfilling promise, obj=%lu, argv=%p, nargs=%lu\n", obj, argv,
+              argc);
 }
 
 void zjs_reject_promise(jerry_value_t obj, jerry_value_t argv[], uint32_t argc)
 {
-    struct promise* handle;
-    jerry_value_t promise_obj = zjs_get_property(obj, "promise");
-
-    jerry_get_object_native_handle(promise_obj, (uintptr_t*)&handle);
-
-    // Put *something* here in case it never gets registered
-    if (!handle->catch_set) {
-        handle->catch = jerry_create_external_function(null_function);
+    struct promise* p = get_promise(obj);
+    if (p) {
+        settle_promise(p, PROMISE_REJECTED, argv, argc);
     }
 
-    handle->catch_id = zjs_add_callback_once(handle->catch,
-                                             obj,
-                                             handle,
-                                             pre_catch,
-                                             post_promise);
-    handle->catch_argv = argv;
-    handle->catch_argc = argc;
-
-    zjs_signal_callback(handle->catch_id);
-
-    DBG_PRINT("rejecting promise, obj=%lu, catch_id=%ld, argv=%p, nargs=%lu\n",
-              obj, handle->catch_id, argv, argc);
+    DBG_PRINT("rejecting promise, obj=%lu, argv=%p, nargs=%lu\n", obj, argv,
+              argc);
 }
@@ -6,14 +6,19 @@
 #include "zjs_util.h"
 
 /*
- * Function called after a promise has been fulfilled or rejected
+ * Function called once a promise has been fulfilled or rejected; the promise
+ * holds its own references to the values by then, so the arguments passed to
+ * zjs_fulfill_promise() or zjs_reject_promise() can be released
  *
  * @param handle        Handle given to zjs_make_promise()
  */
 typedef void (*zjs_post_promise_func)(void* handle);
 
 /*
- * Turn an object into a promise
+ * Turn an object into a promise. Its then() and catch() return a new promise
+ * that settles with the result of the handler, and handlers run as microtasks
+ * as soon as the current callback returns, not on a later pass of the main
+ * loop.
  *
  * @param obj           Object to make a promise
  * @param post          Function to be called when the promise has been fulfilled/rejected
@@ -2,53 +2,108 @@
 
 #ifdef ZJS_LINUX_BUILD
 
+#include <fcntl.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "zjs_script.h"
 
+// initial buffer size for scripts that can't be mapped, doubled as needed
+#define READ_CHUNK_SIZE 4096
+
+// the script mapped by zjs_read_script, if any, so zjs_free_script knows to
+//   unmap it instead of freeing it
+static const char* mapped_script = NULL;
+static size_t mapped_length = 0;
+
+static char* read_fd(int fd, uint32_t* length)
+{
+    // effects: reads fd until end of file into a buffer from malloc, and
+    //            returns it, or NULL on error; the script can be bigger than
+    //            any pool block, so it doesn't use zjs_malloc
+    uint32_t size = READ_CHUNK_SIZE;
+    uint32_t used = 0;
+    char* s = (char*)malloc(size);
+    if (!s) {
+        PRINT("zjs_read_script: Error allocating %u bytes, fatal\n", size);
+        return NULL;
+    }
+
+    while (1) {
+        if (used == size) {
+            char* bigger = (char*)realloc(s, size * 2);
+            if (!bigger) {
+                PRINT("zjs_read_script: Error allocating %u bytes, fatal\n",
+                      size * 2);
+                free(s);
+                return NULL;
+            }
+            s = bigger;
+            size *= 2;
+        }
+
+        ssize_t count = read(fd, s + used, size - used);
+        if (count == 0) {
+            break;
+        }
+        if (count < 0) {
+            PRINT("zjs_read_script: Error reading script file\n");
+            free(s);
+            return NULL;
+        }
+        used += count;
+    }
+
+    *length = used;
+    return s;
+}
+
 void zjs_read_script(char* name, const char** script, uint32_t* length)
 {
+    // effects: maps a regular file read-only, so it's parsed in place without
+    //            a copy; reads pipes, and stdin if name is "-", into memory
     if (name) {
-        char* s;
-        uint32_t size;
-        FILE* f = fopen(name, "r");
-        if (!f) {
+        int fd = strcmp(name, "-") ? open(name, O_RDONLY) : STDIN_FILENO;
+        if (fd < 0) {
             PRINT("zjs_read_script: Error opening file\n");
             return;
         }
-        if (fseek(f, 0L, SEEK_END)) {
-            PRINT("zjs_read_script: Error seeking to end of file\n");
-            fclose(f);
-            return;
-        }
-        size = ftell(f);
-        if (size == -1) {
-            PRINT("zjs_read_script: Error, ftell returned -1\n");
-            fclose(f);
+
+        struct stat st;
+        if (fstat(fd, &st)) {
+            PRINT("zjs_read_script: Error getting file size\n");
+            if (fd != STDIN_FILENO) {
+                close(fd);
+            }
             return;
         }
-        if (fseek(f, 0L, SEEK_SET)) {
-            PRINT("zjs_read_script: Error seeking to beginning of file\n");
-            fclose(f);
-            return;
+
+        // mmap can't map an empty file, so leave those to read()
+        if (S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                mapped_script = map;
+                mapped_length = st.st_size;
+                *script = map;
+                *length = st.st_size;
+                if (fd != STDIN_FILENO) {
+                    close(fd);
+                }
+                return;
+            }
         }
-        s = (char*)zjs_malloc(size);
-        if (!s) {
-            PRINT("zjs_read_script: Error allocating %u bytes, fatal\n", size);
-            fclose(f);
-            return;
+
+        char* s = read_fd(fd, length);
+        if (s) {
+            *script = s;
         }
-        if (fread(s, size, 1, f) != 1) {
-            PRINT("zjs_read_script: Error reading script file\n");
-            fclose(f);
-            zjs_free(s);
-            return;
+        if (fd != STDIN_FILENO) {
+            close(fd);
         }
-
-        *script = s;
-        *length = size;
-        fclose(f);
     }
 
     return;
@@ -57,7 +112,13 @@ void zjs_read_script(char* name, const char** script, uint32_t* length)
 void zjs_free_script(const char* script)
 {
     if (script) {
-        zjs_free(script);
+        if (script == mapped_script) {
+            munmap((void*)mapped_script, mapped_length);
+            mapped_script = NULL;
+            mapped_length = 0;
+        } else {
+            free((void*)script);
+        }
     }
     return;
 }
@@ -8,8 +8,11 @@
 
 #include <stdlib.h>
 
+// Load the script in file name, or from stdin if name is "-"; regular files
+//   are mapped read-only rather than copied. On error, script is left as is.
 void zjs_read_script(char* name, const char** script, uint32_t* length);
 
+// Release a script from zjs_read_script, once it has been parsed
 void zjs_free_script(const char* script);
 
 #endif /* ZJS_SCRIPT_H_ */
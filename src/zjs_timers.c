@@ -16,20 +16,44 @@
 // ZJS includes
 #include "zjs_util.h"
 #include "zjs_callbacks.h"
+#include "zjs_objpool.h"
+
+// states for zjs_timer_t index, other than a position in the timer heap
+#define TIMER_FIRED  -1  // one-shot timer waiting for its callback to run
+#define TIMER_DEAD   -2  // timer is gone, but its JS object still refers to it
+
+// arguments stored in the timer itself, more than this are heap allocated
+#define TIMER_INLINE_ARGS   2
+// timers kept for reuse, more than this are heap allocated
+#define TIMER_POOL_SIZE     8
 
 typedef struct zjs_timer {
-    zjs_port_timer_t timer;
-    void *timer_data;
     jerry_value_t* argv;
     uint32_t argc;
     uint32_t interval;
+    uint32_t expires;       // uptime in ticks when the timer is next due
+    uint32_t seq;           // orders timers that expire on the same tick
     int32_t callback_id;
+    int32_t index;          // position in timer_heap, or TIMER_FIRED/DEAD
     bool repeat;
-    bool completed;
-    struct zjs_timer *next;
+    bool has_obj;           // the JS timer object is still alive
+    struct zjs_timer *next; // link in the fired list
+    jerry_value_t args[TIMER_INLINE_ARGS];
 } zjs_timer_t;
 
-static zjs_timer_t *zjs_timers = NULL;
+ZJS_OBJPOOL(timer_pool, zjs_timer_t, TIMER_POOL_SIZE)
+
+// binary min-heap of running timers, ordered by expiration time, so only the
+//   timers that are actually due get touched in zjs_timers_process_events
+static zjs_timer_t **timer_heap = NULL;
+static int32_t timer_count = 0;
+static int32_t timer_limit = 0;
+static uint32_t timer_seq = 0;
+
+#define TIMER_HEAP_INITIAL_SIZE  4
+
+// one-shot timers that have fired; freed after their callback has been called
+static zjs_timer_t *fired_timers = NULL;
 
 jerry_value_t* pre_timer(void* h, uint32_t* argc)
 {
@@ -38,8 +62,104 @@ jerry_value_t* pre_timer(void* h, uint32_t* argc)
     return handle->argv;
 }
 
+static bool timer_before(zjs_timer_t *a, zjs_timer_t *b)
+{
+    // effects: returns true if a is due before b; the tick count wraps, so
+    //            compare the signed difference
+    int32_t diff = (int32_t)(a->expires - b->expires);
+    if (diff)
+        return diff < 0;
+    return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static void heap_set(int32_t index, zjs_timer_t *tm)
+{
+    timer_heap[index] = tm;
+    tm->index = index;
+}
+
+static void heap_sift_up(int32_t index)
+{
+    zjs_timer_t *tm = timer_heap[index];
+    while (index > 0) {
+        int32_t parent = (index - 1) / 2;
+        if (!timer_before(tm, timer_heap[parent]))
+            break;
+        heap_set(index, timer_heap[parent]);
+        index = parent;
+    }
+    heap_set(index, tm);
+}
+
+static void heap_sift_down(int32_t index)
+{
+    zjs_timer_t *tm = timer_heap[index];
+    while (1) {
+        int32_t child = index * 2 + 1;
+        if (child >= timer_count)
+            break;
+        if (child + 1 < timer_count &&
+            timer_before(timer_heap[child + 1], timer_heap[child]))
+            child++;
+        if (!timer_before(timer_heap[child], tm))
+            break;
+        heap_set(index, timer_heap[child]);
+        index = child;
+    }
+    heap_set(index, tm);
+}
+
+static bool heap_insert(zjs_timer_t *tm)
+{
+    // effects: adds tm to the heap, growing it if needed; returns false if
+    //            out of memory
+    if (timer_count == timer_limit) {
+        int32_t limit = timer_limit ? timer_limit * 2 : TIMER_HEAP_INITIAL_SIZE;
+        zjs_timer_t **heap = zjs_malloc(sizeof(zjs_timer_t *) * limit);
+        if (!heap) {
+            DBG_PRINT("error allocating space for timer heap\n");
+            return false;
+        }
+        if (timer_heap) {
+            memcpy(heap, timer_heap, sizeof(zjs_timer_t *) * timer_count);
+            zjs_free(timer_heap);
+        }
+        timer_heap = heap;
+        timer_limit = limit;
+    }
+    tm->seq = timer_seq++;
+    heap_set(timer_count++, tm);
+    heap_sift_up(tm->index);
+    return true;
+}
+
+static void heap_remove(zjs_timer_t *tm)
+{
+    // requires: tm is in the heap
+    //  effects: takes tm out of the heap, filling its spot with the last timer
+    int32_t index = tm->index;
+    zjs_timer_t *last = timer_heap[--timer_count];
+    if (last != tm) {
+        heap_set(index, last);
+        heap_sift_down(index);
+        heap_sift_up(last->index);
+    }
+}
+
+static void timer_obj_free(const uintptr_t native)
+{
+    // effects: the JS timer object was garbage collected, so the timer struct
+    //            can go away once the timer itself is done
+    zjs_timer_t *tm = (zjs_timer_t *)native;
+    if (tm->index == TIMER_DEAD) {
+        timer_pool_free(tm);
+    } else {
+        tm->has_obj = false;
+    }
+}
+
 /*
- * Allocate a new timer and add it to list
+ * Allocate a new timer and add it to the heap
  *
  * interval     Time until expiration (in ticks)
  * callback     JS callback function
@@ -57,55 +177,82 @@ static zjs_timer_t* add_timer(uint32_t interval,
     int i;
     zjs_timer_t *tm;
 
-    tm = zjs_malloc(sizeof(zjs_timer_t));
+    tm = timer_pool_alloc();
     if (!tm) {
         PRINT("add_timer: out of memory allocating timer struct\n");
         return NULL;
     }
 
-    zjs_port_timer_init(&tm->timer, &tm->timer_data);
+    // an interval shorter than a tick would expire again in the same pass
+    if (repeat && interval == 0)
+        interval = 1;
+
     tm->interval = interval;
+    tm->expires = zjs_port_timer_get_uptime() + interval;
     tm->repeat = repeat;
-    tm->completed = false;
-    tm->next = zjs_timers;
-    tm->callback_id = zjs_add_callback(callback, this, tm, pre_timer, NULL);
+    tm->has_obj = false;
+    tm->next = NULL;
     tm->argc = argc;
-    tm->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
+    if (argc > TIMER_INLINE_ARGS) {
+        tm->argv = zjs_malloc(sizeof(jerry_value_t) * argc);
+        if (!tm->argv) {
+            PRINT("add_timer: out of memory allocating timer args\n");
+            timer_pool_free(tm);
+            return NULL;
+        }
+    } else {
+        tm->argv = tm->args;
+    }
+    tm->callback_id = zjs_add_callback(callback, this, tm, pre_timer, NULL);
+    if (tm->callback_id == -1 || !heap_insert(tm)) {
+        zjs_remove_callback(tm->callback_id);
+        if (tm->argv != tm->args) {
+            zjs_free(tm->argv);
+        }
+        timer_pool_free(tm);
+        return NULL;
+    }
     for (i = 0; i < argc; ++i) {
         tm->argv[i] = jerry_acquire_value(argv[i + 2]);
     }
 
-    zjs_timers = tm;
-
-    zjs_port_timer_start(&tm->timer, interval);
+    // make the main loop recompute how long it can sleep
+    zjs_loop_unblock();
     return tm;
 }
 
 /*
- * Remove a timer from the list
- *
- * id           ID of timer, returned from add_timer
+ * Stop a timer and release everything it holds
  *
- * returns      True if the timer was removed successfully (if the ID is valid)
+ * tm           Timer returned from add_timer, running or fired
  */
-static bool delete_timer(int32_t id)
-{
-    for (zjs_timer_t **ptm = &zjs_timers; *ptm; ptm = &(*ptm)->next) {
-        zjs_timer_t *tm = *ptm;
-        if (id == tm->callback_id) {
-            int i;
-            zjs_port_timer_stop(&tm->timer);
-            *ptm = tm->next;
-            for (i = 0; i < tm->argc; ++i) {
-                jerry_release_value(tm->argv[i]);
+static void delete_timer(zjs_timer_t *tm)
+{
+    int i;
+    if (tm->index >= 0) {
+        heap_remove(tm);
+    } else {
+        for (zjs_timer_t **ptm = &fired_timers; *ptm; ptm = &(*ptm)->next) {
+            if (*ptm == tm) {
+                *ptm = tm->next;
+                break;
             }
-            zjs_remove_callback(tm->callback_id);
-            zjs_free(tm->argv);
-            zjs_free(tm);
-            return true;
         }
     }
-    return false;
+    for (i = 0; i < tm->argc; ++i) {
+        jerry_release_value(tm->argv[i]);
+    }
+    zjs_remove_callback(tm->callback_id);
+    if (tm->argv != tm->args) {
+        zjs_free(tm->argv);
+    }
+
+    if (tm->has_obj) {
+        // the JS object still points at us, free from its native callback
+        tm->index = TIMER_DEAD;
+    } else {
+        timer_pool_free(tm);
+    }
 }
 
 static jerry_value_t add_timer_helper(const jerry_value_t function_obj,
@@ -124,9 +271,13 @@ static jerry_value_t add_timer_helper(const jerry_value_t function_obj,
     jerry_value_t timer_obj = jerry_create_object();
 
     zjs_timer_t* handle = add_timer(interval, callback, this, repeat, argv, argc - 2);
-    if (handle->callback_id == -1)
+    if (!handle) {
+        jerry_release_value(timer_obj);
         return zjs_error("native_set_interval_handler: timer alloc failed");
-    jerry_set_object_native_handle(timer_obj, (uintptr_t)handle, NULL);
+    }
+    handle->has_obj = true;
+    jerry_set_object_native_handle(timer_obj, (uintptr_t)handle,
+                                   timer_obj_free);
 
     return timer_obj;
 }
@@ -175,31 +326,44 @@ static jerry_value_t native_clear_interval_handler(const jerry_value_t function_
         return zjs_error("native_clear_interval_handler(): native handle not found");
     }
 
-    if (!delete_timer(handle->callback_id))
+    if (handle->index == TIMER_DEAD)
         return zjs_error("native_clear_interval_handler: timer not found");
 
+    delete_timer(handle);
+
     return jerry_create_undefined();
 }
 
-void zjs_timers_process_events()
+int32_t zjs_timers_process_events()
 {
-    for (zjs_timer_t *tm = zjs_timers; tm; tm = tm->next) {
-        if (tm->completed) {
-            delete_timer(tm->callback_id);
-        }
-        else if (zjs_port_timer_test(&tm->timer, ZJS_TICKS_NONE)) {
-            // timer has expired, signal the callback
-            zjs_signal_callback(tm->callback_id);
-
-            // reschedule or remove timer
-            if (tm->repeat) {
-                zjs_port_timer_start(&tm->timer, tm->interval);
-            } else {
-                // delete this timer next time around
-                tm->completed = true;
-            }
+    // the callbacks of timers that fired last time have been serviced by now
+    while (fired_timers) {
+        delete_timer(fired_timers);
+    }
+
+    uint32_t now = zjs_port_timer_get_uptime();
+    while (timer_count > 0) {
+        zjs_timer_t *tm = timer_heap[0];
+        int32_t remain = (int32_t)(tm->expires - now);
+        if (remain > 0)
+            return remain;
+
+        // timer has expired, signal the callback
+        zjs_signal_callback(tm->callback_id);
+
+        // reschedule or retire timer
+        if (tm->repeat) {
+            tm->expires = now + tm->interval;
+            tm->seq = timer_seq++;
+            heap_sift_down(0);
+        } else {
+            heap_remove(tm);
+            tm->index = TIMER_FIRED;
+            tm->next = fired_timers;
+            fired_timers = tm;
         }
     }
+    return ZJS_TICKS_FOREVER;
 }
 
 void zjs_timers_init()
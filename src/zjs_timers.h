@@ -3,7 +3,15 @@
 #ifndef __zjs_timers_h__
 #define __zjs_timers_h__
 
-void zjs_timers_process_events();
+#include "zjs_util.h"
+
+/*
+ * Signal the callbacks of any expired timers
+ *
+ * @return              Ticks until the next timer expires, or ZJS_TICKS_FOREVER
+ *                      if there are no timers
+ */
+int32_t zjs_timers_process_events();
 void zjs_timers_init();
 
 #endif  // __zjs_timers_h__
@@ -4,6 +4,7 @@
 
 // ZJS includes
 #include "zjs_util.h"
+#include "zjs_names.h"
 
 #ifndef ZJS_LINUX_BUILD
 // Zephyr includes
@@ -27,6 +28,7 @@ void zjs_queue_callback(struct zjs_callback *cb) {
     //             wrapper with this structure later, in a safe way, within
     //             the task context for proper serialization
     nano_fifo_put(&zjs_callbacks_fifo, cb);
+    zjs_loop_unblock();
 }
 
 void zjs_run_pending_callbacks()
@@ -48,12 +50,146 @@ void zjs_run_pending_callbacks()
         cb->call_function(cb);
     }
 }
+
+// given whenever there is new work for the main loop, e.g. from an ISR
+static struct nano_sem zjs_loop_sem;
+
+void zjs_loop_init()
+{
+    nano_sem_init(&zjs_loop_sem);
+}
+
+void zjs_loop_unblock()
+{
+    // effects: wakes up the main loop if it is blocked in zjs_loop_block;
+    //            can be called from any context
+    nano_sem_give(&zjs_loop_sem);
+}
+
+void zjs_loop_block(int32_t ticks)
+{
+    // requires: call only from task context; ticks is the longest time to
+    //             wait, or ZJS_TICKS_FOREVER
+    //  effects: idles the CPU until unblocked or the ticks have passed
+    if (ticks == 0)
+        return;
+
+    if (nano_task_sem_take(&zjs_loop_sem, ticks)) {
+        // collapse any other wakeups that queued up while we were busy
+        while (nano_task_sem_take(&zjs_loop_sem, TICKS_NONE));
+    }
+}
+#else
+#include "zjs_linux_time.h"
+
+// the Linux build is single threaded, so new work can only come from the main
+//   loop itself and a flag is enough
+static bool zjs_loop_pending = false;
+
+void zjs_loop_init()
+{
+    zjs_loop_pending = false;
+}
+
+void zjs_loop_unblock()
+{
+    zjs_loop_pending = true;
+}
+
+void zjs_loop_block(int32_t ticks)
+{
+    if (zjs_loop_pending || ticks == 0) {
+        zjs_loop_pending = false;
+        return;
+    }
+
+    // with nothing pending and no timers, nothing can ever wake us up, so
+    //   just doze in long naps instead of spinning
+    if (ticks < 0)
+        ticks = CONFIG_SYS_CLOCK_TICKS_PER_SEC;
+
+    usleep(ticks * (1000000 / CONFIG_SYS_CLOCK_TICKS_PER_SEC));
+}
 #endif // ZJS_LINUX_BUILD
 
+jerry_value_t zjs_names[ZJS_NAME_COUNT];
+
+#define ZJS_NAME_STRING(id, str) str,
+static const char *const zjs_name_strings[ZJS_NAME_COUNT] = {
+    ZJS_NAME_LIST(ZJS_NAME_STRING)
+};
+#undef ZJS_NAME_STRING
+
+// must be a power of two
+#define NAME_CACHE_SIZE     16
+#define NAME_CACHE_MAX_LEN  23
+
+// direct-mapped cache of the other names passed to the helpers below; an
+//   entry is empty while str is empty
+struct name_cache_entry {
+    uint32_t hash;
+    jerry_value_t value;
+    char str[NAME_CACHE_MAX_LEN + 1];
+};
+
+static struct name_cache_entry name_cache[NAME_CACHE_SIZE];
+
+void zjs_names_init(void)
+{
+    for (int i = 0; i < ZJS_NAME_COUNT; i++) {
+        zjs_names[i] = jerry_create_string(
+            (const jerry_char_t *)zjs_name_strings[i]);
+    }
+}
+
+void zjs_names_cleanup(void)
+{
+    for (int i = 0; i < ZJS_NAME_COUNT; i++) {
+        jerry_release_value(zjs_names[i]);
+    }
+    for (int i = 0; i < NAME_CACHE_SIZE; i++) {
+        if (name_cache[i].str[0]) {
+            jerry_release_value(name_cache[i].value);
+            name_cache[i].str[0] = '\0';
+        }
+    }
+}
+
+uint32_t zjs_hash_string(const char *str)
+{
+    // effects: returns the FNV-1a hash of str
+    uint32_t hash = 2166136261u;
+    for (; *str; str++) {
+        hash = (hash ^ (uint8_t)*str) * 16777619u;
+    }
+    return hash;
+}
+
+static jerry_value_t acquire_name(const char *str)
+{
+    // requires: str is a property name string
+    //  effects: returns str as a JS string, reusing a cached one if possible;
+    //             the caller must release it
+    size_t len = strnlen(str, NAME_CACHE_MAX_LEN + 1);
+    if (len == 0 || len > NAME_CACHE_MAX_LEN)
+        return jerry_create_string((const jerry_char_t *)str);
+
+    uint32_t hash = zjs_hash_string(str);
+    struct name_cache_entry *entry = &name_cache[hash & (NAME_CACHE_SIZE - 1)];
+    if (entry->hash != hash || strcmp(entry->str, str)) {
+        if (entry->str[0])
+            jerry_release_value(entry->value);
+        entry->value = jerry_create_string((const jerry_char_t *)str);
+        entry->hash = hash;
+        memcpy(entry->str, str, len + 1);
+    }
+    return jerry_acquire_value(entry->value);
+}
+
 void zjs_set_property(const jerry_value_t obj, const char *str,
                       const jerry_value_t prop)
 {
-    jerry_value_t name = jerry_create_string((const jerry_char_t *)str);
+    jerry_value_t name = acquire_name(str);
     jerry_set_property(obj, name, prop);
     jerry_release_value(name);
 }
@@ -63,7 +199,7 @@ jerry_value_t zjs_get_property(const jerry_value_t obj, const char *name)
     // requires: obj is an object, name is a property name string
     //  effects: looks up the property name in obj, and returns it; the value
     //             will be owned by the caller and must be released
-    jerry_value_t jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_value_t jname = acquire_name(name);
     jerry_value_t rval = jerry_get_property(obj, jname);
     jerry_release_value(jname);
     return rval;
@@ -73,7 +209,7 @@ void zjs_obj_add_boolean(jerry_value_t obj, bool flag, const char *name)
 {
     // requires: obj is an existing JS object
     //  effects: creates a new field in parent named name, set to value
-    jerry_value_t jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_value_t jname = acquire_name(name);
     jerry_value_t jbool = jerry_create_boolean(flag);
     jerry_set_property(obj, jname, jbool);
     jerry_release_value(jname);
@@ -89,7 +225,7 @@ void zjs_obj_add_function(jerry_value_t obj, void *func, const char *name)
     // NOTE: The docs on this function make it look like func obj should be
     //   released before we return, but in a loop of 25k buffer creates there
     //   seemed to be no memory leak. Reconsider with future intelligence.
-    jerry_value_t jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_value_t jname = acquire_name(name);
     jerry_value_t jfunc = jerry_create_external_function(func);
     if (jerry_value_is_function(jfunc)) {
         jerry_set_property(obj, jname, jfunc);
@@ -98,12 +234,23 @@ void zjs_obj_add_function(jerry_value_t obj, void *func, const char *name)
     jerry_release_value(jfunc);
 }
 
+void zjs_obj_add_functions(jerry_value_t obj, const zjs_native_func_t *funcs)
+{
+    // requires: obj is an existing JS object, funcs is an array of native C
+    //             functions and their names, ending with a NULL function
+    //  effects: adds a JS function field to obj for each entry in funcs; use
+    //             this to fill in a prototype shared by many objects
+    for (; funcs->function; funcs++) {
+        zjs_obj_add_function(obj, funcs->function, funcs->name);
+    }
+}
+
 void zjs_obj_add_object(jerry_value_t parent, jerry_value_t child,
                         const char *name)
 {
     // requires: parent and child are existing JS objects
     //  effects: creates a new field in parent named name, that refers to child
-    jerry_value_t jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_value_t jname = acquire_name(name);
     jerry_set_property(parent, jname, child);
     jerry_release_value(jname);
 }
@@ -112,7 +259,7 @@ void zjs_obj_add_string(jerry_value_t obj, const char *str, const char *name)
 {
     // requires: obj is an existing JS object
     //  effects: creates a new field in parent named name, set to sval
-    jerry_value_t jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_value_t jname = acquire_name(name);
     jerry_value_t jstr = jerry_create_string((const jerry_char_t *)str);
     jerry_set_property(obj, jname, jstr);
     jerry_release_value(jname);
@@ -123,7 +270,7 @@ void zjs_obj_add_number(jerry_value_t obj, double num, const char *name)
 {
     // requires: obj is an existing JS object
     //  effects: creates a new field in parent named name, set to nval
-    jerry_value_t jname = jerry_create_string((const jerry_char_t *)name);
+    jerry_value_t jname = acquire_name(name);
     jerry_value_t jnum = jerry_create_number(num);
     jerry_set_property(obj, jname, jnum);
     jerry_release_value(jname);
@@ -13,31 +13,20 @@
 
 #ifdef ZJS_LINUX_BUILD
 #include <stdlib.h>
-#define zjs_malloc(sz) malloc(sz)
-#define zjs_free(ptr) free((void *)ptr)
-#else
-#ifndef ZJS_POOL_CONFIG
-#ifdef ZJS_TRACE_MALLOC
-#include <zephyr.h>
-#define zjs_malloc(sz) ({void *zjs_ptr = task_malloc(sz); PRINT("%s:%d: allocating %lu bytes (%p)\n", __func__, __LINE__, (uint32_t)sz, zjs_ptr); zjs_ptr;})
-#define zjs_free(ptr) (PRINT("%s:%d: freeing %p\n", __func__, __LINE__, ptr), task_free(ptr))
 #else
 #include <zephyr.h>
-#define zjs_malloc(sz) task_malloc(sz)
-#define zjs_free(ptr) task_free(ptr)
-#endif  // ZJS_TRACE_MALLOC
-#else
+#endif
+
+// allocations go through zjs_mem, which picks the pools or the heap and
+//   counts them by module; each call site keeps the owner ID it counts
+//   against in a static byte
+#include "zjs_mem.h"
+#define zjs_malloc(sz) ({static uint8_t zjs_owner = 0; zjs_mem_alloc(&zjs_owner, __FILE__, __LINE__, sz);})
 #ifdef ZJS_TRACE_MALLOC
-#include <zephyr.h>
-#define zjs_malloc(sz) ({void *zjs_ptr = pool_malloc(sz); PRINT("%s:%d: allocating %lu bytes (%p)\n", __func__, __LINE__, (uint32_t)sz, zjs_ptr); zjs_ptr;})
-#define zjs_free(ptr) (PRINT("%s:%d: freeing %p\n", __func__, __LINE__, ptr), pool_free(ptr))
+#define zjs_free(ptr) (PRINT("%s:%d: freeing %p\n", __func__, __LINE__, ptr), zjs_mem_free((void *)ptr))
 #else
-#include <zephyr.h>
-#define zjs_malloc(sz) pool_malloc(sz)
-#define zjs_free(ptr) pool_free(ptr)
+#define zjs_free(ptr) zjs_mem_free((void *)ptr)
 #endif  // ZJS_TRACE_MALLOC
-#endif  // ZJS_POOL_CONFIG
-#endif  // ZJS_LINUX_BUILD
 
 struct zjs_callback;
 
@@ -57,12 +46,24 @@ void zjs_queue_init();
 void zjs_queue_callback(struct zjs_callback *cb);
 void zjs_run_pending_callbacks();
 
+// The main loop sleeps in zjs_loop_block() until the next timer deadline, or
+//   until zjs_loop_unblock() reports new work (safe to call from an ISR)
+void zjs_loop_init();
+void zjs_loop_unblock();
+void zjs_loop_block(int32_t ticks);
+
 void zjs_set_property(const jerry_value_t obj, const char *str,
                       const jerry_value_t prop);
 jerry_value_t zjs_get_property (const jerry_value_t obj, const char *str);
 
+typedef struct zjs_native_func {
+    void *function;
+    const char *name;
+} zjs_native_func_t;
+
 void zjs_obj_add_boolean(jerry_value_t obj, bool flag, const char *name);
 void zjs_obj_add_function(jerry_value_t obj, void *function, const char *name);
+void zjs_obj_add_functions(jerry_value_t obj, const zjs_native_func_t *funcs);
 void zjs_obj_add_object(jerry_value_t parent, jerry_value_t child,
                         const char *name);
 void zjs_obj_add_string(jerry_value_t obj, const char *str, const char *name);
@@ -75,6 +76,8 @@ bool zjs_obj_get_double(jerry_value_t obj, const char *name, double *num);
 bool zjs_obj_get_uint32(jerry_value_t obj, const char *name, uint32_t *num);
 bool zjs_obj_get_int32(jerry_value_t obj, const char *name, int32_t *num);
 
+uint32_t zjs_hash_string(const char *str);
+
 bool zjs_hex_to_byte(char *buf, uint8_t *byte);
 
 void zjs_default_convert_pin(uint32_t orig, int *dev, int *pin);
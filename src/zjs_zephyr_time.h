@@ -5,12 +5,9 @@
 
 #include <zephyr.h>
 
-#define zjs_port_timer_t        struct nano_timer
-#define zjs_port_timer_init     nano_timer_init
-#define zjs_port_timer_start    nano_timer_start
-#define zjs_port_timer_stop     nano_task_timer_stop
-#define zjs_port_timer_test     nano_task_timer_test
+#define zjs_port_timer_get_uptime sys_tick_get_32
 #define ZJS_TICKS_NONE          TICKS_NONE
+#define ZJS_TICKS_FOREVER       TICKS_UNLIMITED
 #define zjs_sleep               task_sleep
 
 #endif /* ZJS_ZEPHYR_TIME_H_ */
@@ -72,6 +72,57 @@ try {
 }
 
 
+// Signed, float and double readers and writers
+var typed = [["Int8", -100, 1],
+             ["Int16BE", -12345, 2],
+             ["Int16LE", -12345, 2],
+             ["Int32BE", -123456789, 4],
+             ["Int32LE", -123456789, 4],
+             ["FloatBE", 1.5, 4],
+             ["FloatLE", -0.25, 4],
+             ["DoubleBE", Math.PI, 8],
+             ["DoubleLE", -1e300, 8]];
+buff = new Buffer(10);
+for(var i = 0; i < typed.length; i++) {
+    buff["write" + typed[i][0]](typed[i][1], 1);
+    var actual = buff["read" + typed[i][0]](1);
+    assert(actual === typed[i][1],
+           "The value of read" + typed[i][0] + "() expected:" + typed[i][1] +
+           " got:" + actual);
+    var test_typed_error = "Error thrown when read" + typed[i][0] +
+                           "() goes past the end of the Buffer";
+    try {
+        buff["read" + typed[i][0]](buff.length - typed[i][2] + 1);
+        assert(false, test_typed_error);
+    } catch(e) {
+        assert(true, test_typed_error);
+    }
+}
+
+buff.fill(0);
+buff.writeInt16BE(-2, 0);
+assert(buff.readUInt16BE(0) === 0xfffe && buff.readInt8(0) === -1,
+       "Signed values are stored in two's complement");
+buff.writeFloatLE(1, 0);
+assert(buff.readUInt32LE(0) === 0x3f800000,
+       "writeFloatLE() stores IEEE 754 single precision");
+
+// Function: array readArray(string type, unsigned long offset, unsigned long count)
+buff = new Buffer([1, 2, 0xff, 0xfe, 0, 5]);
+var values = buff.readArray("Int16BE", 0, 3);
+assert(values.length === 3 && values[0] === 0x102 && values[1] === -2 &&
+       values[2] === 5, "readArray() reads count values in a row");
+assert(buff.readArray("UInt16LE", 1).length === 2,
+       "readArray() reads as many values as fit by default");
+
+var test_readArray_error = "Error thrown when readArray() goes past the end of the Buffer";
+try {
+    buff.readArray("UInt32LE", 0, 2);
+    assert(false, test_readArray_error);
+} catch(e) {
+    assert(true, test_readArray_error);
+}
+
 // Function: string toString(string encoding)
 var hexs = [[0, "00"],
             [17, "11"],
@@ -87,6 +138,59 @@ for(var i = 0; i < hexs.length; i++) {
 assert(buff.toString('hex') === expected,
        "The value of toString('hex') expected:" + expected + " got:" + buff.toString('hex'));
 
+assert(new Buffer(expected, "hex").equals(buff),
+       "Buffer(string, 'hex') decodes what toString('hex') returns");
+
+var b64s = [["", ""],
+            ["f", "Zg=="],
+            ["fo", "Zm8="],
+            ["foo", "Zm9v"],
+            ["foob", "Zm9vYg=="],
+            ["fooba", "Zm9vYmE="],
+            ["foobar", "Zm9vYmFy"]];
+for(var i = 0; i < b64s.length; i++) {
+    var b64 = new Buffer(b64s[i][0]).toString("base64");
+    assert(b64 === b64s[i][1],
+           "toString('base64') of '" + b64s[i][0] + "' expected:" + b64s[i][1] +
+           " got:" + b64);
+    assert(new Buffer(b64s[i][1], "base64").equals(new Buffer(b64s[i][0])),
+           "Buffer('" + b64s[i][1] + "', 'base64') decodes to '" +
+           b64s[i][0] + "'");
+}
+
+var bin = new Buffer([0xfb, 0xff, 0x00, 0x3e]);
+assert(bin.toString("base64") === "+/8APg==" &&
+       new Buffer("-_8APg", "base64").equals(bin),
+       "base64 round trip with standard and URL-safe digits");
+var big = new Buffer(512);
+for (var i = 0; i < big.length; i++) {
+    big.writeUInt8((i * 7) & 0xff, i);
+}
+var bighex = big.toString("hex");
+assert(bighex.length === 1024 && new Buffer(bighex, "hex").equals(big),
+       "hex round trip of a 512 byte buffer");
+var big64 = big.toString("base64");
+assert(big64.length === 684 && new Buffer(big64, "base64").equals(big),
+       "base64 round trip of a 512 byte buffer");
+var bigcopy = new Buffer(512);
+assert(bigcopy.write(bighex, "hex") === 512 && bigcopy.equals(big) &&
+       bigcopy.write(big64, "base64") === 512 && bigcopy.equals(big),
+       "write() of a 512 byte buffer as hex and base64");
+
+assert(new Buffer("12g4", "hex").length === 1,
+       "Buffer(string, 'hex') stops at the first invalid pair");
+
+var target = new Buffer(6);
+target.fill(0);
+assert(target.write("a0b1c2d3", 1, "hex") === 4 &&
+       target.readUInt32BE(1) === 0xa0b1c2d3 && target.readUInt8(5) === 0,
+       "write(string, offset, 'hex') decodes into the buffer");
+assert(target.write("AQIDBAUGBwg=", "base64") === 6 &&
+       target.readUInt8(0) === 1 && target.readUInt8(5) === 6,
+       "write(string, 'base64') stops at the end of the buffer");
+assert(target.write("xyz", 4, 1) === 1 && target.readUInt8(4) === 120 &&
+       target.readUInt8(5) === 6, "write(string, offset, length) in utf8");
+
 var test_toString_error = "Error thrown when 'hex' is not given to toString()";
 try {
     // unsupported encoding
@@ -95,3 +199,128 @@ try {
 } catch(e) {
     assert(true, test_toString_error);
 }
+
+
+// Function: Buffer slice(long start, long end)
+buff = new Buffer(8);
+for(var i = 0; i < buff.length; i++) {
+    buff.writeUInt8(i, i);
+}
+var slices = [[[], 0, 8],
+              [[2], 2, 6],
+              [[2, 5], 2, 3],
+              [[-3], 5, 3],
+              [[1, -1], 1, 6],
+              [[6, 2], 6, 0],
+              [[-20, 20], 0, 8],
+              [[NaN, 5e9], 0, 8],
+              [[-1e12, NaN], 0, 0]];
+for(var i = 0; i < slices.length; i++) {
+    var args = slices[i][0];
+    var view;
+    if (args.length == 0) {
+        view = buff.slice();
+    } else if (args.length == 1) {
+        view = buff.slice(args[0]);
+    } else {
+        view = buff.slice(args[0], args[1]);
+    }
+    var ok = view.length === slices[i][2];
+    for(var j = 0; ok && j < view.length; j++) {
+        ok = view.readUInt8(j) === slices[i][1] + j;
+    }
+    assert(ok, "slice(" + args + ") expected " + slices[i][2] +
+           " bytes from offset " + slices[i][1] + " got:" + view.length);
+}
+
+var view = buff.slice(2, 6);
+view.writeUInt8(200, 0);
+assert(buff.readUInt8(2) === 200, "Writes to a slice show up in its parent");
+buff.writeUInt8(100, 5);
+assert(view.readUInt8(3) === 100, "Writes to the parent show up in a slice");
+assert(view.slice(1, 3).readUInt8(0) === buff.readUInt8(3),
+       "A slice of a slice shares the original memory");
+
+var test_slice_error = "Error thrown when reading beyond the end of a slice";
+try {
+    view.readUInt8(4);
+    assert(false, test_slice_error);
+} catch(e) {
+    assert(true, test_slice_error);
+}
+
+// copy, fill, equals, compare, indexOf and Buffer.concat
+var src = new Buffer([1, 2, 3, 4, 5, 6]);
+var dst = new Buffer(4);
+dst.fill(0);
+assert(src.copy(dst, 1, 2) === 3 && dst.readUInt8(0) === 0 &&
+       dst.readUInt8(1) === 3 && dst.readUInt8(3) === 5,
+       "copy: copies as many bytes as fit at the target offset");
+assert(src.copy(src, 0, 2, 5) === 3 && src.readUInt8(0) === 3 &&
+       src.readUInt8(2) === 5 && src.readUInt8(3) === 4,
+       "copy: overlapping source and target");
+
+var filled = new Buffer(7);
+assert(filled.fill(0x1ff) === filled && filled.readUInt8(6) === 0xff,
+       "fill: a number fills every byte and returns the buffer");
+filled.fill("ab", 1, 6);
+assert(filled.readUInt8(0) === 0xff && filled.readUInt8(1) === 97 &&
+       filled.readUInt8(4) === 98 && filled.readUInt8(5) === 97 &&
+       filled.readUInt8(6) === 0xff, "fill: a string repeats within range");
+
+filled.fill(4294967297);
+assert(filled.readUInt8(0) === 1, "fill: a number past 2^32 wraps modulo 256");
+filled.fill(NaN);
+assert(filled.readUInt8(0) === 0, "fill: NaN fills with zero");
+var wrapped = new Buffer([-1, 256, Infinity, 1e20]);
+assert(wrapped.readUInt8(0) === 255 && wrapped.readUInt8(1) === 0 &&
+       wrapped.readUInt8(2) === 0 && wrapped.readUInt8(3) === 0,
+       "Buffer(array): values wrap modulo 256 and non-finite ones are zero");
+
+var test_fill_error = "fill: error thrown when the range is out of bounds";
+try {
+    filled.fill(0, 2, 8);
+    assert(false, test_fill_error);
+} catch(e) {
+    assert(true, test_fill_error);
+}
+
+var abc = new Buffer("abc");
+assert(abc.equals(new Buffer("abc")), "equals: same bytes");
+assert(!abc.equals(new Buffer("abd")) && !abc.equals(new Buffer("ab")),
+       "equals: different bytes or length");
+assert(abc.compare(new Buffer("abc")) === 0 &&
+       abc.compare(new Buffer("abd")) === -1 &&
+       abc.compare(new Buffer("ab")) === 1, "compare: returns -1, 0 or 1");
+
+var hay = new Buffer("abcabc");
+assert(hay.indexOf(98) === 1 && hay.indexOf(98, 2) === 4,
+       "indexOf: finds a byte value from an offset");
+assert(hay.indexOf("ca") === 2 && hay.indexOf(new Buffer("bc"), 3) === 4,
+       "indexOf: finds a string or Buffer");
+assert(hay.indexOf("cb") === -1 && hay.indexOf(120) === -1,
+       "indexOf: returns -1 when not found");
+
+var joined = Buffer.concat([abc, hay.slice(3)]);
+assert(joined.length === 6 && joined.equals(new Buffer("abcabc")),
+       "concat: joins buffers in order");
+joined = Buffer.concat([abc, abc], 8);
+assert(joined.length === 8 && joined.readUInt8(5) === 99 &&
+       joined.readUInt8(7) === 0, "concat: zero fills up to totalLength");
+assert(Buffer.concat([abc, abc], 2).equals(new Buffer("ab")),
+       "concat: truncates to totalLength");
+
+// Function: object toJSON()
+var json = new Buffer([1, 2, 255]).toJSON();
+assert(json.type === "Buffer" && json.data.length === 3 &&
+       json.data[0] === 1 && json.data[2] === 255,
+       "toJSON() returns the bytes as a plain array");
+assert(JSON.stringify(new Buffer([7, 8])) ===
+       '{"type":"Buffer","data":[7,8]}', "JSON.stringify() uses toJSON()");
+
+// Constructor: Buffer(Buffer other)
+var orig = new Buffer([1, 2, 3]);
+var dup = new Buffer(orig);
+dup.writeUInt8(9, 0);
+assert(dup.length === 3 && dup.readUInt8(2) === 3 && orig.readUInt8(0) === 1,
+       "Buffer(buffer) copies the contents");
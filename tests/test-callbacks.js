@@ -0,0 +1,91 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Callback Testing: timers and events share callback IDs, which are reused
+//   once freed
+
+var total = 0;
+var passed = 0;
+
+function assert(actual, description) {
+    total += 1;
+
+    var label = "\033[1m\033[31mFAIL\033[0m";
+    if (actual === true) {
+        passed += 1;
+        label = "\033[1m\033[32mPASS\033[0m";
+    }
+
+    print(label + " - " + description);
+}
+
+// enough callbacks to grow the callback map a few times, then free most of
+//   them so their IDs go back on the free list
+var fired = [];
+var timers = [];
+for (var i = 0; i < 40; i++) {
+    timers.push(setTimeout(function(n) {
+        fired.push(n);
+    }, 300, i));
+}
+for (var i = 0; i < 40; i++) {
+    if (i % 4) {
+        clearTimeout(timers[i]);
+    }
+}
+
+// new callbacks take the freed IDs; only they and the kept timers may fire
+for (var i = 40; i < 70; i++) {
+    setTimeout(function(n) {
+        fired.push(n);
+    }, 300, i);
+}
+
+// an event listener reusing a freed ID gets only its own emits
+var EventEmitter = require("events");
+var emitter = new EventEmitter();
+var heard = [];
+emitter.on("ping", function(n) {
+    heard.push("old" + n);
+});
+emitter.removeAllListeners("ping");
+emitter.on("pong", function(n) {
+    heard.push("new" + n);
+});
+emitter.emit("ping", 1);
+emitter.emit("pong", 2);
+
+// callbacks run in the order they were signaled, not the order of their IDs
+var order = [];
+var emitters = [new EventEmitter(), new EventEmitter(), new EventEmitter()];
+for (var i = 0; i < emitters.length; i++) {
+    emitters[i].on("go", function(n) {
+        order.push(n);
+        if (n === "b") {
+            // signaled while the queue is being serviced, so runs after it
+            emitters[0].emit("go", "late");
+        }
+    });
+}
+emitters[2].emit("go", "c");
+emitters[0].emit("go", "a");
+emitters[1].emit("go", "b");
+
+setTimeout(function() {
+    var expected = [];
+    for (var i = 0; i < 40; i += 4) {
+        expected.push(i);
+    }
+    for (var i = 40; i < 70; i++) {
+        expected.push(i);
+    }
+    assert(fired.join() === expected.join(),
+           "only live timers fire after their IDs are freed and reused");
+
+    assert(heard.join() === "new2",
+           "a listener on a reused ID gets only its own emits");
+
+    assert(order.join() === "c,a,b,late",
+           "callbacks run in the order they were signaled: " + order.join());
+
+    print("TOTAL: " + passed + " of " + total + " passed");
+}, 1000);
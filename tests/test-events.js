@@ -0,0 +1,75 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Event Testing
+
+var total = 0;
+var passed = 0;
+
+function assert(actual, description) {
+    total += 1;
+
+    var label = "\033[1m\033[31mFAIL\033[0m";
+    if (actual === true) {
+        passed += 1;
+        label = "\033[1m\033[32mPASS\033[0m";
+    }
+
+    print(label + " - " + description);
+}
+
+var EventEmitter = require("events");
+
+// a listener removes itself during an emit; the rest still get that emit
+var emitter = new EventEmitter();
+var calls = [];
+function once(n) {
+    calls.push("once" + n);
+    emitter.removeListener("tick", once);
+}
+emitter.on("tick", once);
+emitter.on("tick", function(n) {
+    calls.push("always" + n);
+});
+assert(emitter.emit("tick", 1) === true, "emit() returns true with listeners");
+emitter.emit("tick", 2);
+
+// the last listener for a name is removed, so the name goes away
+var names = new EventEmitter();
+function onA() {}
+names.on("a", onA);
+names.on("b", function() {});
+assert(names.eventNames().length === 2, "eventNames() lists both names");
+names.removeListener("a", onA);
+assert(names.eventNames().join() === "b",
+       "eventNames() drops a name once its last listener is removed");
+assert(names.listenerCount("a") === 0, "listenerCount() of a removed name");
+assert(names.emit("a") === false,
+       "emit() returns false once a name has no listeners");
+names.removeAllListeners("b");
+assert(names.eventNames().length === 0,
+       "eventNames() is empty after removeAllListeners()");
+names.on("a", onA);
+assert(names.eventNames().join() === "a", "a removed name can be used again");
+
+// more emits than used to fit in the queue for one name are all delivered
+var burst = new EventEmitter();
+var got = [];
+burst.on("data", function(n) {
+    got.push(n);
+});
+for (var i = 0; i < 20; i++) {
+    burst.emit("data", i);
+}
+
+setTimeout(function() {
+    assert(calls.join() === "once1,always1,always2",
+           "removing a listener during an emit: " + calls.join());
+
+    var inorder = got.length === 20;
+    for (var i = 0; i < got.length; i++) {
+        inorder = inorder && got[i] === i;
+    }
+    assert(inorder, "a burst of 20 emits is delivered in order");
+
+    print("TOTAL: " + passed + " of " + total + " passed");
+}, 500);
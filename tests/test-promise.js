@@ -0,0 +1,79 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Promise Testing: the promises come from gpio.openAsync(), which settles
+//   them before returning
+
+// Hardware Requirements:
+//   - Arduino 101
+
+var total = 0;
+var passed = 0;
+
+function assert(actual, description) {
+    total += 1;
+
+    var label = "\033[1m\033[31mFAIL\033[0m";
+    if (actual === true) {
+        passed += 1;
+        label = "\033[1m\033[32mPASS\033[0m";
+    }
+
+    print(label + " - " + description);
+}
+
+var gpio = require("gpio");
+var pins = require("arduino101_pins");
+
+function open() {
+    return gpio.openAsync({ pin: pins.LED0, activeLow: false });
+}
+
+var order = [];
+
+// a timer set first still runs after every then() handler, even ones queued
+//   by other handlers
+setTimeout(function() {
+    order.push("timer");
+}, 0);
+
+// handlers on one promise run in the order registered, and a chained
+//   handler runs after them
+var p = open();
+p.then(function() {
+    order.push("a1");
+}).then(function() {
+    order.push("a2");
+});
+p.then(function() {
+    order.push("b1");
+});
+
+// a handler that returns a promise settles the chain with its result
+var followed = null;
+p.then(function() {
+    return open();
+}).then(function(pin) {
+    followed = typeof pin.write;
+});
+
+// a handler that throws rejects the chain, and catch() gets the error
+var caught = null;
+p.then(function() {
+    throw new Error("oops");
+}).then(function() {
+    caught = "not rejected";
+}).catch(function(error) {
+    caught = error.message;
+});
+
+setTimeout(function() {
+    assert(order.join() === "a1,b1,a2,timer",
+           "then() handlers run in order, before timers: " + order.join());
+
+    assert(followed === "function",
+           "a promise returned from a handler is followed");
+
+    assert(caught === "oops", "an error thrown in a handler reaches catch()");
+
+    print("TOTAL: " + passed + " of " + total + " passed");
+}, 500);
@@ -0,0 +1,40 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Module Testing: require() keeps the exports of a module after the first call
+
+var total = 0;
+var passed = 0;
+
+function assert(actual, description) {
+    total += 1;
+
+    var label = "\033[1m\033[31mFAIL\033[0m";
+    if (actual === true) {
+        passed += 1;
+        label = "\033[1m\033[32mPASS\033[0m";
+    }
+
+    print(label + " - " + description);
+}
+
+var first = require("events");
+var second = require("events");
+assert(typeof first === "function", "require() returns the module exports");
+assert(first === second, "requiring a module twice returns the same exports");
+
+first.marker = 42;
+assert(require("events").marker === 42,
+       "changes to the exports are seen by later requires");
+
+function throws(name) {
+    try {
+        require(name);
+        return false;
+    } catch (e) {
+        return true;
+    }
+}
+assert(throws("no_such_module"), "require() of an unknown module throws");
+assert(throws("no_such_module"), "an unknown module is not cached");
+
+print("TOTAL: " + passed + " of " + total + " passed");
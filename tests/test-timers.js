@@ -0,0 +1,88 @@
+// Copyright (c) 2016, Intel Corporation.
+
+// Timer Testing
+
+var total = 0;
+var passed = 0;
+
+function assert(actual, description) {
+    total += 1;
+
+    var label = "\033[1m\033[31mFAIL\033[0m";
+    if (actual === true) {
+        passed += 1;
+        label = "\033[1m\033[32mPASS\033[0m";
+    }
+
+    print(label + " - " + description);
+}
+
+// timers with the same deadline fire in the order they were set, more of them
+//   than the timer pool and the initial heap hold
+var same = [];
+for (var i = 0; i < 12; i++) {
+    setTimeout(function(n) {
+        same.push(n);
+    }, 200, i);
+}
+
+// timers set out of order fire in order of their deadlines
+var sorted = [];
+var delays = [300, 100, 250, 150, 50];
+for (var i = 0; i < delays.length; i++) {
+    setTimeout(function(delay) {
+        sorted.push(delay);
+    }, delays[i], delays[i]);
+}
+
+// more arguments than are kept in the timer itself
+var args = null;
+setTimeout(function(a, b, c, d) {
+    args = [a, b, c, d];
+}, 100, 1, "two", 3, "four");
+
+// a callback clears a later timer due on the same tick, and one due later
+var cleared = [];
+var victim1, victim2;
+setTimeout(function() {
+    cleared.push("first");
+    clearTimeout(victim1);
+    clearTimeout(victim2);
+}, 400);
+victim1 = setTimeout(function() {
+    cleared.push("victim1");
+}, 400);
+victim2 = setTimeout(function() {
+    cleared.push("victim2");
+}, 500);
+
+// an interval clears itself from its own callback
+var ticks = 0;
+var interval = setInterval(function() {
+    ticks++;
+    if (ticks === 3) {
+        clearInterval(interval);
+    }
+}, 100);
+
+setTimeout(function() {
+    var inorder = same.length === 12;
+    for (var i = 0; i < same.length; i++) {
+        inorder = inorder && same[i] === i;
+    }
+    assert(inorder, "timers with equal deadlines fire in the order set");
+
+    assert(sorted.join() === "50,100,150,250,300",
+           "timers fire in order of their deadlines: " + sorted.join());
+
+    assert(args !== null && args[0] === 1 && args[1] === "two" &&
+           args[2] === 3 && args[3] === "four",
+           "setTimeout passes extra arguments to the callback");
+
+    assert(cleared.join() === "first",
+           "clearTimeout() from a callback stops timers due now and later");
+
+    assert(ticks === 3, "clearInterval() from its own callback stops it");
+
+    print("TOTAL: " + passed + " of " + total + " passed");
+}, 1000);